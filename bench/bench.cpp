@@ -0,0 +1,253 @@
+#include "flubberpp.h"
+#include "loader.h"
+#include "rotation.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace flubberpp;
+
+namespace {
+
+/** A slightly wavy circle with n vertices about 5 apart, so that normalize() with msl >= 5
+ *  keeps it as is. @c phase turns it, so that the rotation search has something to find
+ */
+VectorShape star(unsigned n, float phase)
+{
+  constexpr float pi = 3.14159265358979323846f;
+  const float radius = 5.f * n / (2.f * pi);
+  VectorShape s(n);
+  for (unsigned i=0; i<n; i++) {
+    const float a = 2.f * pi * i / n + phase;
+    const float r = radius + (i % 2 ? 1.f : -1.f);
+    s[i] = Point { r*std::cos(a), r*std::sin(a) };
+  }
+  return s;
+}
+
+size_t points(const std::vector<VectorShape> &shapes)
+{
+  size_t n = 0;
+  for (const auto &s: shapes)
+    n += s.size();
+  return n;
+}
+
+struct Result {
+  std::string name, dataset;
+  float msl;
+  size_t points;
+  double ns;
+};
+
+class Bench {
+  public:
+    explicit Bench(double minSeconds) : mMinSeconds(minSeconds) {}
+
+    /** Runs @c op, which processes @c points points, until it took at least the minimum time,
+     *  and records its mean duration
+     */
+    void run(const std::string &name, const std::string &dataset, float msl, size_t points,
+             const std::function<void()> &op) {
+      using clock = std::chrono::steady_clock;
+      size_t iterations = 0;
+      const auto start = clock::now();
+      double elapsed = 0.;
+      do {
+        op();
+        iterations++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+      } while ( elapsed < mMinSeconds );
+
+      const Result r { name, dataset, msl, points, elapsed * 1e9 / iterations };
+      std::fprintf(stderr, "%-22s %-14s msl %-6g %9zu points %14.0f ns %10.2f Mpoints/s\n",
+                   r.name.c_str(), r.dataset.c_str(), r.msl, r.points, r.ns, r.points / r.ns * 1e3);
+      mResults.push_back(r);
+    }
+
+    void write(std::FILE *out) const {
+      std::fprintf(out, "{\n  \"version\": 1,\n  \"results\": [\n");
+      for (size_t i=0; i<mResults.size(); i++) {
+        const Result &r = mResults[i];
+        std::fprintf(out, "    { \"name\": \"%s\", \"dataset\": \"%s\", \"maxSegmentLength\": %g, "
+                          "\"points\": %zu, \"ns\": %.0f, \"pointsPerSecond\": %.0f }%s\n",
+                     r.name.c_str(), r.dataset.c_str(), r.msl, r.points, r.ns, r.points / r.ns * 1e9,
+                     i+1 < mResults.size() ? "," : "");
+      }
+      std::fprintf(out, "  ]\n}\n");
+    }
+
+  private:
+    double mMinSeconds;
+    std::vector<Result> mResults;
+};
+
+/** Interpolations between consecutive shapes of a dataset */
+void benchDataset(Bench &bench, const std::string &dataset, const std::vector<VectorShape> &shapes)
+{
+  for (const float msl: { 5.f, 10.f, 20.f }) {
+    const size_t raw = points(shapes);
+
+    bench.run("normalize", dataset, msl, raw, [&]() {
+      for (auto s: shapes)
+        s.normalize(msl);
+    });
+
+    std::vector<VectorShape> normalized(shapes);
+    for (auto &s: normalized)
+      s.normalize(msl);
+
+    bench.run("addPoints", dataset, msl, points(normalized), [&]() {
+      for (auto s: normalized)
+        s.addPoints(s.size() / 10 + 1);
+    });
+
+    // padded pairs, ready to be rotated
+    std::vector<std::pair<VectorShape,VectorShape>> pairs;
+    size_t padded = 0;
+    for (size_t i=0; i+1<normalized.size(); i++) {
+      VectorShape from = normalized[i], to = normalized[i+1];
+      if ( from.size() > to.size() )
+        to.addPoints(from.size() - to.size());
+      else
+        from.addPoints(to.size() - from.size());
+      padded += from.size();
+      pairs.emplace_back(std::move(from), std::move(to));
+    }
+
+    bench.run("rotate/bruteForce", dataset, msl, padded, [&]() {
+      for (const auto &p: pairs)
+        rotation::bruteForce(p.first.data(), p.second.data(), p.first.size());
+    });
+    bench.run("rotate/fft", dataset, msl, padded, [&]() {
+      for (const auto &p: pairs)
+        rotation::fft(p.first.data(), p.second.data(), p.first.size());
+    });
+    bench.run("rotate/approximate", dataset, msl, padded, [&]() {
+      for (const auto &p: pairs)
+        rotation::approximate(p.first.data(), p.second.data(), p.first.size());
+    });
+
+    std::vector<std::shared_ptr<const PreparedMorph>> morphs;
+    bench.run("setup", dataset, msl, raw, [&]() {
+      morphs.clear();
+      for (size_t i=0; i+1<shapes.size(); i++) {
+        SingleInterpolator interp(shapes[i], shapes[i+1], msl);
+        interp.setCache(nullptr);
+        morphs.push_back(interp.prepared());
+      }
+    });
+
+    AlignedFloats x(padded), y(padded);
+    bench.run("at", dataset, msl, padded, [&]() {
+      for (const auto &m: morphs)
+        m->at(0.5f, x.data(), y.data());
+    });
+  }
+}
+
+/** Synthetic shapes up to 1M vertices */
+void benchSynthetic(Bench &bench)
+{
+  for (const unsigned n: { 1000u, 10000u, 100000u, 1000000u }) {
+    const std::string dataset = "star" + std::to_string(n);
+    const VectorShape from = star(n, 0.f), to = star(n, 1.f);
+    // segments are shorter than msl, normalize only checks them
+    const float msl = 10.f;
+
+    bench.run("normalize", dataset, msl, n, [&]() {
+      VectorShape s = from;
+      s.normalize(msl);
+    });
+    bench.run("addPoints", dataset, msl, n, [&]() {
+      VectorShape s = from;
+      s.addPoints(n / 10);
+    });
+    if ( n <= 10000 ) {
+      bench.run("rotate/bruteForce", dataset, msl, n, [&]() {
+        rotation::bruteForce(from.data(), to.data(), n);
+      });
+    }
+    bench.run("rotate/fft", dataset, msl, n, [&]() {
+      rotation::fft(from.data(), to.data(), n);
+    });
+    bench.run("rotate/approximate", dataset, msl, n, [&]() {
+      rotation::approximate(from.data(), to.data(), n);
+    });
+
+    std::shared_ptr<const PreparedMorph> morph;
+    bench.run("setup/fft", dataset, msl, n, [&]() {
+      SingleInterpolator interp(from, to, msl);
+      interp.setCache(nullptr);
+      interp.setRotationMethod(RotationMethod::Fft);
+      morph = interp.prepared();
+    });
+
+    AlignedFloats x(morph->size()), y(morph->size());
+    bench.run("at", dataset, msl, morph->size(), [&]() {
+      morph->at(0.5f, x.data(), y.data());
+    });
+  }
+}
+
+void usage()
+{
+  std::fprintf(stderr, "usage: flubberpp_bench [-d datadir] [-o results.json] [-t seconds per measure]\n");
+}
+
+}
+
+int main(int argc, char **argv)
+{
+  std::string dataDir = FLUBBERPP_DATA_DIR;
+  std::string output;
+  double minSeconds = 0.2;
+  for (int i=1; i<argc; i++) {
+    if ( !std::strcmp(argv[i], "-d") && i+1 < argc ) {
+      dataDir = argv[++i];
+    } else if ( !std::strcmp(argv[i], "-o") && i+1 < argc ) {
+      output = argv[++i];
+    } else if ( !std::strcmp(argv[i], "-t") && i+1 < argc ) {
+      minSeconds = std::atof(argv[++i]);
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  Bench bench(minSeconds);
+  for (const char *dataset: { "basic-shapes", "us-states" }) {
+    const std::string path = dataDir + "/" + dataset + ".json";
+    PackedShapes packed;
+    if ( !loadShapes(path, packed) ) {
+      std::fprintf(stderr, "cannot load %s\n", path.c_str());
+      return 1;
+    }
+    bench.run("loadShapes", dataset, 0.f, packed.points.size(), [&]() {
+      loadShapes(path, packed);
+    });
+
+    std::vector<VectorShape> shapes;
+    for (size_t i=0; i<packed.size(); i++)
+      shapes.emplace_back(packed.begin(i), packed.end(i));
+    benchDataset(bench, dataset, shapes);
+  }
+  benchSynthetic(bench);
+
+  std::FILE *out = output.empty() ? stdout : std::fopen(output.c_str(), "w");
+  if ( !out ) {
+    std::fprintf(stderr, "cannot write %s\n", output.c_str());
+    return 1;
+  }
+  bench.write(out);
+  if ( out != stdout )
+    std::fclose(out);
+
+  return 0;
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+namespace flubberpp {
+
+/** Allocator returning memory aligned on @c Align bytes, suitable for vector loads */
+template <typename T, std::size_t Align = 32>
+struct AlignedAllocator {
+    using value_type = T;
+
+    template <typename U> struct rebind { using other = AlignedAllocator<U, Align>; };
+
+    AlignedAllocator() = default;
+    template <typename U> AlignedAllocator(const AlignedAllocator<U, Align> &) {}
+
+    T *allocate(std::size_t n) {
+      return static_cast<T*>(::operator new(n*sizeof(T), std::align_val_t(Align)));
+    }
+    void deallocate(T *p, std::size_t) {
+      ::operator delete(p, std::align_val_t(Align));
+    }
+
+    template <typename U> bool operator==(const AlignedAllocator<U, Align> &) const { return true; }
+    template <typename U> bool operator!=(const AlignedAllocator<U, Align> &) const { return false; }
+};
+
+/** Contiguous aligned float storage, used for structure of arrays coordinates */
+using AlignedFloats = std::vector<float, AlignedAllocator<float>>;
+/** Same for quantized coordinates */
+using AlignedInt16s = std::vector<std::int16_t, AlignedAllocator<std::int16_t>>;
+
+/** Read only view over structure of arrays coordinates */
+struct XYSpan {
+    const float *x = nullptr;
+    const float *y = nullptr;
+    std::size_t size = 0;
+};
+
+}
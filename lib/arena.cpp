@@ -0,0 +1,64 @@
+#include "arena.h"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace flubberpp {
+
+namespace {
+
+constexpr std::size_t ChunkAlignment = alignof(std::max_align_t);
+
+}
+
+BumpArena::BumpArena(std::size_t chunkSize, std::pmr::memory_resource *upstream)
+  : mChunkSize(std::max<std::size_t>(chunkSize, 1024))
+  , mUpstream(upstream)
+  , mCurrent(0)
+  , mUsed(0)
+  , mAllocated(0)
+{
+}
+
+BumpArena::~BumpArena()
+{
+  for (const auto &c: mChunks) {
+    mUpstream->deallocate(c.data, c.size, ChunkAlignment);
+  }
+}
+
+void BumpArena::reset()
+{
+  mCurrent = 0;
+  mUsed = 0;
+  mAllocated = 0;
+}
+
+void *BumpArena::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+  // try the current chunk, then the next ones kept by reset()
+  for (; mCurrent<mChunks.size(); mCurrent++, mUsed=0) {
+    const Chunk &c = mChunks[mCurrent];
+    const std::size_t start = (reinterpret_cast<std::uintptr_t>(c.data) + mUsed + alignment - 1) / alignment * alignment
+                              - reinterpret_cast<std::uintptr_t>(c.data);
+    if ( start + bytes <= c.size ) {
+      mUsed = start + bytes;
+      mAllocated += bytes;
+      return c.data + start;
+    }
+  }
+
+  // new chunk, big enough for this allocation
+  const std::size_t size = std::max(mChunkSize, bytes + alignment);
+  char *data = static_cast<char*>(mUpstream->allocate(size, ChunkAlignment));
+  mChunks.push_back(Chunk { data, size });
+  mCurrent = mChunks.size()-1;
+
+  const std::size_t start = (reinterpret_cast<std::uintptr_t>(data) + alignment - 1) / alignment * alignment
+                            - reinterpret_cast<std::uintptr_t>(data);
+  mUsed = start + bytes;
+  mAllocated += bytes;
+  return data + start;
+}
+
+}
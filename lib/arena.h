@@ -0,0 +1,59 @@
+#pragma once
+
+#ifdef FLUBBERPP_LIBRARY
+#if _WIN32
+#define FLUBBERPP_EXPORT __declspec(dllexport)
+#else
+#define FLUBBERPP_EXPORT __attribute__((visibility("default")))
+#endif
+#else
+#define FLUBBERPP_EXPORT
+#endif
+
+#include <cstddef>
+#include <memory_resource>
+#include <vector>
+
+namespace flubberpp {
+
+/** A memory resource that hands out memory by bumping a pointer into large chunks.
+ *  Deallocating does nothing: all the memory is reclaimed at once by reset(), in O(1),
+ *  keeping the chunks for the next job. Not thread safe: use one arena per thread/job.
+ */
+class FLUBBERPP_EXPORT BumpArena : public std::pmr::memory_resource {
+  public:
+    /** Builds an arena allocating chunks of at least @c chunkSize bytes from @c upstream */
+    explicit BumpArena(std::size_t chunkSize = 64*1024,
+                       std::pmr::memory_resource *upstream = std::pmr::new_delete_resource());
+    ~BumpArena() override;
+
+    BumpArena(const BumpArena &) = delete;
+    BumpArena &operator=(const BumpArena &) = delete;
+
+    /** Makes all the memory available again. Everything allocated so far must be unused */
+    void reset();
+
+    /** Bytes handed out since the last reset() */
+    std::size_t bytesAllocated() const { return mAllocated; }
+    /** Number of chunks requested to the upstream resource since construction */
+    std::size_t upstreamAllocations() const { return mChunks.size(); }
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override;
+    void do_deallocate(void *, std::size_t, std::size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override { return this == &other; }
+
+    struct Chunk {
+      char *data;
+      std::size_t size;
+    };
+
+    std::size_t mChunkSize;
+    std::pmr::memory_resource *mUpstream;
+    std::vector<Chunk> mChunks;
+    // chunk being filled and position in it
+    std::size_t mCurrent, mUsed;
+    std::size_t mAllocated;
+};
+
+}
@@ -0,0 +1,251 @@
+#include "assignment.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <queue>
+
+namespace flubberpp {
+namespace assignment {
+
+namespace {
+
+constexpr unsigned None = std::numeric_limits<unsigned>::max();
+
+struct Edge {
+  unsigned col;
+  double cost;
+};
+
+/** Uniform grid over the column centroids, for nearest neighbour queries */
+class Grid {
+  public:
+    explicit Grid(const std::vector<Descriptor> &cols)
+      : mCols(cols)
+    {
+      float minX = std::numeric_limits<float>::max(), minY = minX;
+      float maxX = std::numeric_limits<float>::lowest(), maxY = maxX;
+      for (const auto &c: cols) {
+        minX = std::min(minX, c.centroid.x);
+        minY = std::min(minY, c.centroid.y);
+        maxX = std::max(maxX, c.centroid.x);
+        maxY = std::max(maxY, c.centroid.y);
+      }
+
+      // about 2 columns per cell
+      mDim = std::max(1, int(std::ceil(std::sqrt(cols.size()/2.))));
+      mX = minX;
+      mY = minY;
+      mCell = std::max(std::max(maxX-minX, maxY-minY) / mDim, 1e-6f);
+
+      mStart.assign(mDim*mDim+1, 0);
+      for (const auto &c: cols)
+        mStart[cell(c.centroid)+1]++;
+      for (size_t i=1; i<mStart.size(); i++)
+        mStart[i] += mStart[i-1];
+      mIndex.resize(cols.size());
+      std::vector<unsigned> fill(mStart.begin(), mStart.end()-1);
+      for (unsigned j=0; j<cols.size(); j++)
+        mIndex[fill[cell(cols[j].centroid)]++] = j;
+    }
+
+    /** The @c k columns with the nearest centroids to @c p */
+    std::vector<unsigned> nearest(const Point &p, unsigned k) const {
+      // max heap of (squared distance, column)
+      std::priority_queue<std::pair<float,unsigned>> best;
+      const int cx = clamp((p.x-mX)/mCell), cy = clamp((p.y-mY)/mCell);
+
+      for (int r=0; r<=mDim; r++) {
+        // cells of ring r are at least (r-1) cells away from p
+        const float reach = std::max(0, r-1)*mCell;
+        if ( best.size() == k && reach*reach > best.top().first )
+          break;
+
+        for (int y=cy-r; y<=cy+r; y++) {
+          for (int x=cx-r; x<=cx+r; x++) {
+            if ( (std::abs(x-cx) != r && std::abs(y-cy) != r) || x < 0 || y < 0 || x >= mDim || y >= mDim )
+              continue;
+            const int c = y*mDim+x;
+            for (unsigned i=mStart[c]; i<mStart[c+1]; i++) {
+              const Point d = mCols[mIndex[i]].centroid - p;
+              const float dist = d.x*d.x + d.y*d.y;
+              if ( best.size() < k ) {
+                best.emplace(dist, mIndex[i]);
+              } else if ( dist < best.top().first ) {
+                best.pop();
+                best.emplace(dist, mIndex[i]);
+              }
+            }
+          }
+        }
+      }
+
+      std::vector<unsigned> res;
+      for (; !best.empty(); best.pop())
+        res.push_back(best.top().second);
+      return res;
+    }
+
+  private:
+    int clamp(float v) const { return std::min(mDim-1, std::max(0, int(v))); }
+    int cell(const Point &p) const { return clamp((p.y-mY)/mCell)*mDim + clamp((p.x-mX)/mCell); }
+
+    const std::vector<Descriptor> &mCols;
+    int mDim;
+    float mX, mY, mCell;
+    // columns of cell c are mIndex[mStart[c], mStart[c+1][
+    std::vector<unsigned> mStart, mIndex;
+};
+
+/** Assigns a column to each row by shortest augmenting paths (Dijkstra with potentials) over
+ *  @c edges, from an empty assignment. A row without an augmenting path gets every column.
+ *  On return cost(i,j) - u[i] - v[j] is >= 0 on every edge, 0 on assigned pairs, and v is 0 on
+ *  unassigned columns
+ */
+void augment(std::vector<std::vector<Edge>> &edges, const std::vector<Descriptor> &rows,
+             const std::vector<Descriptor> &cols, std::vector<unsigned> &colOf, std::vector<unsigned> &rowOf,
+             std::vector<double> &u, std::vector<double> &v)
+{
+  const unsigned m = rows.size(), n = cols.size();
+  std::fill(colOf.begin(), colOf.end(), None);
+  std::fill(rowOf.begin(), rowOf.end(), None);
+  std::fill(u.begin(), u.end(), 0.);
+  std::fill(v.begin(), v.end(), 0.);
+  std::vector<double> dist(n);
+  std::vector<unsigned> from(n), visited;
+  std::vector<bool> done(n);
+
+  for (unsigned r=0; r<m; r++) {
+    for (;;) {
+      // the free row r takes the largest potential keeping its reduced costs >= 0
+      u[r] = std::numeric_limits<double>::max();
+      for (const auto &e: edges[r])
+        u[r] = std::min(u[r], e.cost - v[e.col]);
+
+      // Dijkstra over columns, going through the row assigned to each reached column
+      std::fill(dist.begin(), dist.end(), std::numeric_limits<double>::max());
+      std::fill(done.begin(), done.end(), false);
+      visited.clear();
+      using Item = std::pair<double,unsigned>;
+      std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+      auto relax = [&](unsigned i, double base) {
+        for (const auto &e: edges[i]) {
+          const double d = base + e.cost - u[i] - v[e.col];
+          if ( d < dist[e.col] ) {
+            dist[e.col] = d;
+            from[e.col] = i;
+            queue.emplace(d, e.col);
+          }
+        }
+      };
+      relax(r, 0.);
+
+      unsigned freeCol = None;
+      while ( !queue.empty() ) {
+        const auto [d, j] = queue.top();
+        queue.pop();
+        if ( done[j] || d > dist[j] )
+          continue;
+        done[j] = true;
+        visited.push_back(j);
+        if ( rowOf[j] == None ) {
+          freeCol = j;
+          break;
+        }
+        relax(rowOf[j], d);
+      }
+
+      if ( freeCol == None ) {
+        // no augmenting path in the sparse graph: this row gets every column
+        edges[r].clear();
+        for (unsigned j=0; j<n; j++)
+          edges[r].push_back(Edge { j, cost(rows[r], cols[j]) });
+        continue;
+      }
+
+      // update the potentials of the settled columns and their rows
+      const double total = dist[freeCol];
+      u[r] += total;
+      for (const auto j: visited) {
+        if ( j == freeCol )
+          continue;
+        v[j] -= total - dist[j];
+        u[rowOf[j]] += total - dist[j];
+      }
+
+      // augment along the path
+      for (unsigned j=freeCol; j!=None; ) {
+        const unsigned i = from[j];
+        const unsigned previous = colOf[i];
+        colOf[i] = j;
+        rowOf[j] = i;
+        j = i == r ? None : previous;
+      }
+      break;
+    }
+  }
+}
+
+}
+
+Descriptor describe(const VectorShape &s)
+{
+  return Descriptor { s.centroid(), std::sqrt(std::abs(s.area())) };
+}
+
+float cost(const Descriptor &a, const Descriptor &b)
+{
+  const Point d = a.centroid - b.centroid;
+  const float size = a.size - b.size;
+  return d.x*d.x + d.y*d.y + size*size;
+}
+
+std::vector<unsigned> solve(const std::vector<Descriptor> &rows, const std::vector<Descriptor> &cols,
+                            unsigned candidates)
+{
+  const unsigned m = rows.size(), n = cols.size();
+  std::vector<unsigned> colOf(m, None), rowOf(n, None);
+  if ( !m || n < m )
+    return colOf;
+
+  // sparse candidate graph
+  const Grid grid(cols);
+  std::vector<std::vector<Edge>> edges(m);
+  for (unsigned i=0; i<m; i++) {
+    for (const auto j: grid.nearest(rows[i].centroid, std::min(candidates, n)))
+      edges[i].push_back(Edge { j, cost(rows[i], cols[j]) });
+  }
+
+  // dual potentials: cost(i,j) - u[i] - v[j] >= 0 on every edge, = 0 on assigned pairs
+  std::vector<double> u(m), v(n);
+  std::vector<unsigned> mark(n, None);
+  for (;;) {
+    augment(edges, rows, cols, colOf, rowOf, u, v);
+
+    // the potentials prove the assignment optimal over the sparse graph, and over every pair
+    // unless a pair left out has a negative reduced cost. Such pairs join the graph, which is
+    // then solved again
+    bool missing = false;
+    for (unsigned i=0; i<m; i++) {
+      for (const auto &e: edges[i])
+        mark[e.col] = i;
+      const size_t known = edges[i].size();
+      for (unsigned j=0; j<n; j++) {
+        if ( mark[j] == i )
+          continue;
+        const double c = cost(rows[i], cols[j]);
+        // tolerates the rounding of the potentials, updated by every augmentation
+        if ( c - u[i] - v[j] < -1e-9 * (c + std::abs(u[i]) + std::abs(v[j])) )
+          edges[i].push_back(Edge { j, c });
+      }
+      missing = missing || edges[i].size() > known;
+    }
+    if ( !missing )
+      break;
+  }
+
+  return colOf;
+}
+
+}
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "shape.h"
+
+#include <vector>
+
+namespace flubberpp {
+
+/** Pairing of shapes minimizing the overall travel cost */
+namespace assignment {
+
+/** What the pairing knows about a shape */
+struct Descriptor {
+  Point centroid;
+  /** Square root of the area, to compare sizes in distance units */
+  float size;
+};
+
+Descriptor describe(const VectorShape &s);
+
+/** Cost of turning a shape into another: squared distance between centroids
+ *  plus squared difference of sizes
+ */
+float cost(const Descriptor &a, const Descriptor &b);
+
+/** Assigns a distinct column to each row, minimizing the total cost(), and returns the
+ *  column of each row. There must be no more rows than columns.
+ *  Only the @c candidates columns with the nearest centroids of each row, found through a
+ *  uniform grid, are considered at first. The assignment is then solved by shortest
+ *  augmenting paths (Dijkstra with potentials) over this sparse graph, a row getting all
+ *  the columns only if it cannot be assigned otherwise. The potentials prove it optimal unless
+ *  a pair left out has a negative reduced cost: a scan of every pair adds those to the graph,
+ *  which is solved again until there are none. @c candidates trades these rounds, usually a
+ *  few, for the size of the graph, not the optimality of the result.
+ */
+std::vector<unsigned> solve(const std::vector<Descriptor> &rows, const std::vector<Descriptor> &cols,
+                            unsigned candidates = 16);
+
+}
+
+}
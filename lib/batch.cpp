@@ -0,0 +1,127 @@
+#include "flubberpp.h"
+#include "serialize.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+namespace flubberpp {
+
+namespace {
+
+/** Points evaluated by each task of MorphBatch::at(), to amortize scheduling */
+constexpr size_t TaskPoints = 32*1024;
+
+}
+
+MorphBatch::MorphBatch(float maxSegmentLength, unsigned threads)
+  : mMsl(maxSegmentLength)
+  , mRotation(RotationMethod::BruteForce)
+  , mQuantized(false)
+  , mPool(threads)
+  , mTasks(1, 0)
+{
+}
+
+void MorphBatch::add(const VectorShape &from, const VectorShape &to)
+{
+  mPairs.emplace_back(from, to);
+}
+
+void MorphBatch::prepare()
+{
+  if ( mPairs.empty() )
+    return;
+
+  // estimated costs, from a bound of the number of points once normalized. It only depends on
+  // the segment lengths, so neither copies nor orientation are needed
+  std::vector<double> cost(mPairs.size());
+  mPool.run(mPairs.size(), [this,&cost](size_t i) {
+    const double n = double(std::max(mPairs[i].first.normalizedSizeBound(mMsl), mPairs[i].second.normalizedSizeBound(mMsl)));
+    cost[i] = mRotation == RotationMethod::BruteForce ? n*n : n*std::log2(n+1);
+  });
+
+  std::vector<size_t> order(mPairs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&cost](size_t a, size_t b) { return cost[a] > cost[b]; });
+
+  const size_t first = mMorphs.size();
+  mMorphs.resize(first + mPairs.size());
+  mPool.run(order.size(), [this,&order,first](size_t k) {
+    const size_t i = order[k];
+    SingleInterpolator interp(mPairs[i].first, mPairs[i].second, mMsl);
+    // the morphs are kept by the batch: caching them would only hash the shapes and evict
+    // the setups of the other interpolators
+    interp.setCache(nullptr);
+    interp.setRotationMethod(mRotation);
+    mMorphs[first+i] = interp.prepared();
+  });
+  mPairs.clear();
+
+  layout();
+}
+
+bool MorphBatch::save(const std::string &path)
+{
+  if ( !mPairs.empty() )
+    prepare();
+
+  return saveMorphs(path, mMorphs);
+}
+
+bool MorphBatch::load(const std::string &path)
+{
+  std::vector<std::shared_ptr<const PreparedMorph>> morphs;
+  if ( !loadMorphs(path, morphs) )
+    return false;
+
+  mPairs.clear();
+  mMorphs = std::move(morphs);
+  layout();
+
+  return true;
+}
+
+void MorphBatch::layout()
+{
+  // output layout, and tasks of at least TaskPoints points
+  mCur = PackedShapes();
+  mTasks.assign(1, 0);
+  size_t points = 0;
+  for (size_t i=0; i<mMorphs.size(); i++) {
+    mCur.offsets.push_back(mCur.offsets.back() + mMorphs[i]->size());
+    points += mMorphs[i]->size();
+    if ( points >= TaskPoints || i+1 == mMorphs.size() ) {
+      mTasks.push_back(i+1);
+      points = 0;
+    }
+  }
+  mCur.points.resize(mCur.offsets.back());
+
+  mQuantizedMorphs.clear();
+  if ( mQuantized ) {
+    mQuantizedMorphs.resize(mMorphs.size());
+    mPool.run(mMorphs.size(), [this](size_t i) {
+      mQuantizedMorphs[i] = QuantizedMorph(*mMorphs[i]);
+    });
+  }
+}
+
+const PackedShapes &MorphBatch::at(float dt)
+{
+  if ( !mPairs.empty() )
+    prepare();
+
+  mPool.run(mTasks.size()-1, [this,dt](size_t t) {
+    for (size_t i=mTasks[t]; i<mTasks[t+1]; i++) {
+      if ( mQuantizedMorphs.empty() )
+        mMorphs[i]->at(dt, mCur.points.begin() + mCur.offsets[i]);
+      else
+        mQuantizedMorphs[i].at(dt, mCur.points.begin() + mCur.offsets[i]);
+    }
+  });
+
+  return mCur;
+}
+
+}
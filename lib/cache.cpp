@@ -0,0 +1,202 @@
+#include "flubberpp.h"
+
+#include <cstring>
+
+namespace flubberpp {
+
+namespace {
+
+std::uint64_t rotl(std::uint64_t v, unsigned r)
+{
+  return (v << r) | (v >> (64 - r));
+}
+
+/** Two independent 64 bits lanes, enough to make collisions between distinct setups negligible */
+class Hasher {
+  public:
+    void add(std::uint64_t w) {
+      mA = rotl(mA ^ (w * 0x9E3779B97F4A7C15ull), 27) * 0xC2B2AE3D27D4EB4Full + 0x165667B19E3779F9ull;
+      mB = rotl(mB + (w * 0xD6E8FEB86659FD93ull), 31) * 0x9FB21C651E98DF25ull ^ 0x27D4EB2F165667C5ull;
+    }
+    void add(float f) {
+      std::uint32_t bits;
+      std::memcpy(&bits, &f, sizeof(bits));
+      add(std::uint64_t(bits));
+    }
+    void add(double f) {
+      std::uint64_t bits;
+      std::memcpy(&bits, &f, sizeof(bits));
+      add(bits);
+    }
+
+    MorphCache::Key key() const {
+      return MorphCache::Key { mix(mA), mix(mB) };
+    }
+
+  private:
+    static std::uint64_t mix(std::uint64_t v) {
+      v ^= v >> 33;
+      v *= 0xFF51AFD7ED558CCDull;
+      v ^= v >> 33;
+      v *= 0xC4CEB9FE1A85EC53ull;
+      return v ^ (v >> 33);
+    }
+
+    std::uint64_t mA = 0x243F6A8885A308D3ull, mB = 0x13198A2E03707344ull;
+};
+
+/** Hashes the coordinates type, the number of points and the points */
+template <typename S>
+MorphCache::Key hashPoints(const S &s)
+{
+  Hasher h;
+  h.add(std::uint64_t(sizeof(typename S::Scalar)));
+  h.add(std::uint64_t(s.size()));
+  for (const auto &p: s) {
+    h.add(p.x);
+    h.add(p.y);
+  }
+  return h.key();
+}
+
+std::size_t entryBytes(const MorphCache::Entry &e)
+{
+  return 4 * e.morph->size() * sizeof(float);
+}
+
+}
+
+MorphCache::MorphCache(std::size_t budget)
+  : mBudget(budget)
+  , mBytes(0)
+  , mHits(0)
+  , mMisses(0)
+{
+}
+
+MorphCache &MorphCache::global()
+{
+  static MorphCache cache;
+  return cache;
+}
+
+MorphCache::Key MorphCache::hash(const VectorShape &s)
+{
+  return hashPoints(s);
+}
+
+MorphCache::Key MorphCache::hash(const VectorShapeD &s)
+{
+  return hashPoints(s);
+}
+
+MorphCache::Key MorphCache::key(const Key &from, const Key &to, double maxSegmentLength, RotationMethod method,
+                                unsigned decimation, unsigned candidates,
+                                ResamplingMethod resampling, std::size_t maxPoints)
+{
+  Hasher h;
+  h.add(from.a);
+  h.add(from.b);
+  h.add(to.a);
+  h.add(to.b);
+  h.add(maxSegmentLength);
+  h.add(std::uint64_t(method));
+  // the approximation settings only matter to the approximate search
+  if ( method == RotationMethod::Approximate ) {
+    h.add(std::uint64_t(decimation));
+    h.add(std::uint64_t(candidates));
+  }
+  h.add(std::uint64_t(resampling));
+  h.add(std::uint64_t(maxPoints));
+  return h.key();
+}
+
+bool MorphCache::find(const Key &key, Entry &entry)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = mIndex.find(key);
+  if ( it == mIndex.end() ) {
+    mMisses++;
+    return false;
+  }
+
+  mHits++;
+  mEntries.splice(mEntries.begin(), mEntries, it->second);
+  entry = it->second->second;
+  return true;
+}
+
+void MorphCache::insert(const Key &key, const Entry &entry)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  auto it = mIndex.find(key);
+  if ( it != mIndex.end() ) {
+    mBytes -= entryBytes(it->second->second);
+    mEntries.erase(it->second);
+    mIndex.erase(it);
+  }
+
+  if ( entryBytes(entry) > mBudget )
+    return;
+
+  mEntries.emplace_front(key, entry);
+  mIndex[key] = mEntries.begin();
+  mBytes += entryBytes(entry);
+  evict();
+}
+
+void MorphCache::clear()
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mEntries.clear();
+  mIndex.clear();
+  mBytes = 0;
+}
+
+void MorphCache::setBudget(std::size_t budget)
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  mBudget = budget;
+  evict();
+}
+
+std::size_t MorphCache::budget() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mBudget;
+}
+
+std::size_t MorphCache::bytes() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mBytes;
+}
+
+std::size_t MorphCache::size() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mEntries.size();
+}
+
+std::size_t MorphCache::hits() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mHits;
+}
+
+std::size_t MorphCache::misses() const
+{
+  std::lock_guard<std::mutex> lock(mMutex);
+  return mMisses;
+}
+
+void MorphCache::evict()
+{
+  while ( mBytes > mBudget ) {
+    mBytes -= entryBytes(mEntries.back().second);
+    mIndex.erase(mEntries.back().first);
+    mEntries.pop_back();
+  }
+}
+
+}
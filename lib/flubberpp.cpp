@@ -1,151 +1,377 @@
 #include "flubberpp.h"
+#include "rotation.h"
+#include "simplify.h"
 
 #include <list>
 #include <set>
 #include <cmath>
 #include <algorithm>
+#include <chrono>
+#include <limits>
 
-#include "earcut.hpp"
+namespace flubberpp {
 
-// Make earcut library able to use our Point type
-namespace mapbox {
-namespace util {
+#ifdef FLUBBERPP_ENABLE_STATS
+namespace {
 
-template <>
-struct nth<0, flubberpp::Point> {
-    inline static auto get(const flubberpp::Point &t) {
-        return t.x;
-    };
-};
-template <>
-struct nth<1, flubberpp::Point> {
-    inline static auto get(const flubberpp::Point &t) {
-        return t.y;
-    };
-};
+using StatsClock = std::chrono::steady_clock;
 
-} // namespace util
-} // namespace mapbox
+/** Nanoseconds since @c since, which becomes now */
+std::uint64_t lap(StatsClock::time_point &since)
+{
+  const auto now = StatsClock::now();
+  const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(now - since).count();
+  since = now;
+  return ns;
+}
 
-namespace flubberpp {
+}
+#endif
 
-SingleInterpolator::SingleInterpolator(const VectorShape &from, const VectorShape &to, float maxSegmentLength)
+template <typename T>
+BasicSingleInterpolator<T>::BasicSingleInterpolator(const ShapeType &from, const ShapeType &to, T maxSegmentLength,
+                                                    std::pmr::memory_resource *mr)
   : mMsl(maxSegmentLength)
+  , mMr(mr)
+  , mRotation(RotationMethod::BruteForce)
+  , mThreads(1)
+  , mDecimation(0)
+  , mCandidates(4)
+  , mResampling(ResamplingMethod::Uniform)
+  , mMaxPoints(0)
+  , mCache(&MorphCache::global())
+  , mFromHashed(false)
+  , mToHashed(false)
+  , mFromResampled(false)
+  , mToResampled(false)
+  , mMorph(std::make_shared<const PreparedMorph>())
+  , mOrigin { 0, 0 }
+  , mLevelsOfDetail(false)
   , dirty(false)
 {
   setStartShape(from);
   setEndShape(to);
 }
 
-SingleInterpolator::SingleInterpolator(float maxSegmentLength)
+template <typename T>
+BasicSingleInterpolator<T>::BasicSingleInterpolator(T maxSegmentLength, std::pmr::memory_resource *mr)
   : mMsl(maxSegmentLength)
+  , mMr(mr)
+  , mRotation(RotationMethod::BruteForce)
+  , mThreads(1)
+  , mDecimation(0)
+  , mCandidates(4)
+  , mResampling(ResamplingMethod::Uniform)
+  , mMaxPoints(0)
+  , mCache(&MorphCache::global())
+  , mFromHashed(false)
+  , mToHashed(false)
+  , mFromResampled(false)
+  , mToResampled(false)
+  , mMorph(std::make_shared<const PreparedMorph>())
+  , mOrigin { 0, 0 }
+  , mLevelsOfDetail(false)
+  , dirty(false)
 {
 }
 
-void SingleInterpolator::setStartShape(const VectorShape &s)
+template <typename T>
+void BasicSingleInterpolator<T>::setStartShape(const ShapeType &s)
 {
-  // switch to lists to alter shapes
-  mFromList = ListShape(s.cbegin(),s.cend());
-  mFromList.normalize(mMsl);
+  mFromShape.assign(s.cbegin(),s.cend());
+  mFromHashed = false;
+  mFromResampled = false;
   dirty = true;
 }
 
-void SingleInterpolator::setEndShape(const VectorShape &s)
+template <typename T>
+void BasicSingleInterpolator<T>::setEndShape(const ShapeType &s)
 {
-  // switch to lists to alter shapes
-  mToList = ListShape(s.cbegin(),s.cend());
-  mToList.normalize(mMsl);
+  mToShape.assign(s.cbegin(),s.cend());
+  mToHashed = false;
+  mToResampled = false;
   dirty = true;
 }
 
-const VectorShape &SingleInterpolator::at(float dt)
+template <typename T>
+void BasicSingleInterpolator<T>::setMemoryResource(std::pmr::memory_resource *mr)
 {
-  if ( dirty )
-    setup();
+  mMr = mr;
+  FLUBBERPP_STATS(mCounter.setUpstream(mr);)
+}
+
+template <typename T>
+void BasicSingleInterpolator<T>::setRotationMethod(RotationMethod method)
+{
+  mRotation = method;
+}
+
+template <typename T>
+void BasicSingleInterpolator<T>::setApproximation(unsigned decimation, unsigned candidates)
+{
+  mDecimation = decimation;
+  mCandidates = candidates;
+}
+
+template <typename T>
+void BasicSingleInterpolator<T>::setResampling(ResamplingMethod method)
+{
+  if ( method != mResampling )
+    mFromResampled = mToResampled = false;
+  mResampling = method;
+}
 
-  auto it2 = mTo.cbegin();
-  auto it3 = mCur.begin();
+template <typename T>
+void BasicSingleInterpolator<T>::setMaxPoints(std::size_t maxPoints)
+{
+  if ( maxPoints != mMaxPoints )
+    mFromResampled = mToResampled = false;
+  mMaxPoints = maxPoints;
+}
+
+template <typename T>
+void BasicSingleInterpolator<T>::setLevelsOfDetail(bool enabled)
+{
+  mLevelsOfDetail = enabled;
+  if ( !enabled )
+    mLevels = MorphLevels();
+  else if ( !dirty && !mLevels.size() && mMorph->size() )
+    mLevels = MorphLevels(*mMorph);
+}
+
+template <typename T>
+void BasicSingleInterpolator<T>::setThreadCount(unsigned threads)
+{
+  mThreads = std::max(1u, threads);
+}
+
+template <typename T>
+const typename BasicSingleInterpolator<T>::ShapeType &BasicSingleInterpolator<T>::at(float dt)
+{
+  const XYSpan xy = atXY(dt);
 
-  for (auto it=mFrom.cbegin(); it!=mFrom.cend(); ++it, ++it2, ++it3) {
-    const Point &a = *it;
-    const Point &b = *it2;
-    *it3 = Point {
-        a.x + (b.x-a.x)*dt,
-        a.y + (b.y-a.y)*dt
-    };
+  if constexpr(std::is_same_v<T,float>) {
+    for (size_t i=0; i<xy.size; i++) {
+      mCur[i] = Point { xy.x[i], xy.y[i] };
+    }
+  } else {
+    for (size_t i=0; i<xy.size; i++) {
+      mCur[i] = PointType { mOrigin.x + xy.x[i], mOrigin.y + xy.y[i] };
+    }
   }
 
   return mCur;
 }
 
-void SingleInterpolator::setup()
+template <typename T>
+XYSpan BasicSingleInterpolator<T>::atXY(float dt)
 {
-  if ( dirty ) {
-    if ( mFromList.size() > mToList.size() ) {
-      mToList.addPoints(mFromList.size() - mToList.size());
-    } else {
-      mFromList.addPoints(mToList.size() - mFromList.size());
-    }
+  if ( dirty )
+    setup();
 
-    rotate(mFromList, mToList);
+  mMorph->at(dt, mCurX.data(), mCurY.data());
 
-    // we keep a mCur list so that we don't perform an allocate each time at() is called
-    // back to vectors
-    mCur = mFrom = VectorShape(mFromList.cbegin(),mFromList.cend());
-    mTo = VectorShape(mToList.cbegin(),mToList.cend());
+  return XYSpan { mCurX.data(), mCurY.data(), mMorph->size() };
+}
 
-    // we no longer need the lists
-    mFromList.clear();
-    mToList.clear();
+template <typename T>
+const typename BasicSingleInterpolator<T>::ShapeType &BasicSingleInterpolator<T>::at(float dt, float tolerance)
+{
+  const XYSpan xy = atXY(dt, tolerance);
+
+  mLodCur.resize(xy.size);
+  for (size_t i=0; i<xy.size; i++) {
+    mLodCur[i] = PointType { mOrigin.x + xy.x[i], mOrigin.y + xy.y[i] };
   }
-  dirty = false;
+
+  return mLodCur;
 }
 
-VectorShapeSet SingleInterpolator::triangulate(const VectorShape &s) const
+template <typename T>
+XYSpan BasicSingleInterpolator<T>::atXY(float dt, float tolerance)
 {
-  VectorShapeSet res;
+  if ( dirty )
+    setup();
 
-  // earcut expects a polygon = main shape + hole1 + hole2 + ...
-  // we assume we don't have holes
-  std::vector<VectorShape> polygon;
-  polygon.push_back(s);
-  auto indices = mapbox::earcut(polygon);
+  const size_t level = mLevels.size() ? mLevels.level(tolerance) : 0;
+  if ( !level )
+    return atXY(dt);
 
-  for (auto i=0; i<indices.size(); i+=3) {
-    // Note: we have no holes so all indices lie within polygon[0]
-    res.insert({ polygon[0][i], polygon[0][i+1], polygon[0][i+2]}); // sorted insert
-  }
+  const size_t n = mLevels.at(*mMorph, dt, level, mCurX.data(), mCurY.data());
+  return XYSpan { mCurX.data(), mCurY.data(), n };
+}
+
+template <typename T>
+std::shared_ptr<const PreparedMorph> BasicSingleInterpolator<T>::prepared()
+{
+  if ( dirty )
+    setup();
 
-  return res;
+  return mMorph;
 }
 
-void SingleInterpolator::rotate(ListShape &from, const ListShape &to)
+template <typename T>
+typename BasicSingleInterpolator<T>::PointType BasicSingleInterpolator<T>::origin()
 {
-  // unfortunately we need to change the beginning of the 'from' list.
-  // so a vector is required
-  const std::vector<Point> v(from.begin(),from.end());
-  auto bestOffset = from.begin();
-  unsigned offset = 0;
-  float minDist = std::numeric_limits<float>::max();
+  if ( dirty )
+    setup();
 
-  for (auto it=from.begin(); it!=from.end(); ++it, ++offset) {
-    // for each start of the v list, check distances to 'to' list
-    float dist = 0.f;
-    unsigned i=0;
-    for (auto it2=to.cbegin(); it2!=to.cend(); ++it2,++i) {
-      const auto d = v[(offset+i)%from.size()].distance(*it2);
-      dist += d*d;
+  return mOrigin;
+}
+
+template <typename T>
+void BasicSingleInterpolator<T>::setup()
+{
+  if ( dirty ) {
+    FLUBBERPP_STATS(
+      mStats = SetupStats();
+      mStats.fromPoints = mFromShape.size();
+      mStats.toPoints = mToShape.size();
+      mCounter.resetBytes();
+      auto start = StatsClock::now(), last = start;
+    )
+
+    // shapes are hashed only for the cache, and only the sides that changed
+    MorphCache::Key key;
+    if ( mCache ) {
+      if ( !mFromHashed ) {
+        mFromKey = MorphCache::hash(mFromShape);
+        mFromHashed = true;
+      }
+      if ( !mToHashed ) {
+        mToKey = MorphCache::hash(mToShape);
+        mToHashed = true;
+      }
+      key = MorphCache::key(mFromKey, mToKey, mMsl, mRotation, mDecimation, mCandidates, mResampling, mMaxPoints);
     }
+    MorphCache::Entry cached;
+    if ( mCache && mCache->find(key, cached) ) {
+      mMorph = cached.morph;
+      mRotationReport = cached.report;
+      mResamplingReport = cached.resampling;
+      mOrigin = PointType { T(cached.origin.x), T(cached.origin.y) };
+      FLUBBERPP_STATS(mStats.cached = true;)
+    } else {
+      mResamplingReport.uniformPoints = std::max(mFromShape.normalizedSizeBound(mMsl), mToShape.normalizedSizeBound(mMsl));
+      // only the sides that changed since the last setup are resampled again
+      if ( !mFromResampled ) {
+        resample(mFromShape, mFromRing);
+        mFromPadded.clear();
+        mFromResampled = true;
+      }
+      if ( !mToResampled ) {
+        resample(mToShape, mToRing);
+        mToPadded.clear();
+        mToResampled = true;
+      }
+      FLUBBERPP_STATS(
+        mStats.normalizeNs = lap(last);
+        mStats.fromNormalized = mFromRing.size();
+        mStats.toNormalized = mToRing.size();
+      )
+
+      // the rings are padded on copies, kept for the next setup: a side is padded again only
+      // when its ring or the padded size changed
+      const std::size_t size = std::max(mFromRing.size(), mToRing.size());
+      for (auto [ring, padded]: { std::pair { &mFromRing, &mFromPadded }, std::pair { &mToRing, &mToPadded } }) {
+        if ( padded->size() != size ) {
+          padded->assign(ring->cbegin(), ring->cend());
+          padded->addPoints(size - ring->size());
+        }
+      }
+      FLUBBERPP_STATS(
+        mStats.addPointsNs = lap(last);
+        mStats.addedPoints = size - std::min(mStats.fromNormalized, mStats.toNormalized);
+      )
+
+      if constexpr(std::is_same_v<T,float>) {
+        const unsigned offset = rotate(mFromPadded.data(), mToPadded.data(), size);
+        FLUBBERPP_STATS(mStats.rotateNs = lap(last);)
+        std::pmr::vector<Point> from(size, resource());
+        std::rotate_copy(mFromPadded.cbegin(), mFromPadded.cbegin()+offset, mFromPadded.cend(), from.begin());
+        mMorph = std::make_shared<const PreparedMorph>(from.data(), from.data()+size, mToPadded.data());
+      } else {
+        // float shapes relative to the center of both shapes
+        T minX = std::numeric_limits<T>::max(), minY = minX, maxX = -minX, maxY = -minX;
+        for (const auto *shape: { &mFromPadded, &mToPadded }) {
+          for (const auto &p: *shape) {
+            minX = std::min(minX, p.x);
+            maxX = std::max(maxX, p.x);
+            minY = std::min(minY, p.y);
+            maxY = std::max(maxY, p.y);
+          }
+        }
+        mOrigin = mFromPadded.empty() ? PointType { 0, 0 } : PointType { (minX+maxX)/2, (minY+maxY)/2 };
+
+        PmrVectorShape from(resource()), to(resource());
+        from.reserve(size);
+        to.reserve(size);
+        for (const auto &p: mFromPadded)
+          from.push_back(Point { float(p.x - mOrigin.x), float(p.y - mOrigin.y) });
+        for (const auto &p: mToPadded)
+          to.push_back(Point { float(p.x - mOrigin.x), float(p.y - mOrigin.y) });
 
-    if ( dist < minDist ) {
-      minDist = dist;
-      bestOffset = it;
+        const unsigned offset = rotate(from.data(), to.data(), size);
+        FLUBBERPP_STATS(mStats.rotateNs = lap(last);)
+        std::rotate(from.begin(), from.begin()+offset, from.end());
+        mMorph = std::make_shared<const PreparedMorph>(from.cbegin(), from.cend(), to.cbegin());
+      }
+      mResamplingReport.points = mMorph->size();
+      if ( mCache )
+        mCache->insert(key, MorphCache::Entry { mMorph, mRotationReport, mResamplingReport, PointD { double(mOrigin.x), double(mOrigin.y) } });
+      FLUBBERPP_STATS(
+        mStats.prepareNs = lap(last);
+        mStats.bytesAllocated = mCounter.bytes() + 4*mMorph->size()*sizeof(float);
+      )
     }
-  }
+    const size_t n = mMorph->size();
+
+    // we keep the current shape buffers so that we don't perform an allocation each time at() is called
+    mCurX.resize(n);
+    mCurY.resize(n);
+    mCur.resize(n);
 
-  if ( bestOffset != from.begin() ) {
-    std::rotate(from.begin(),bestOffset,from.end());
+    mLevels = mLevelsOfDetail && n ? MorphLevels(*mMorph) : MorphLevels();
+
+    FLUBBERPP_STATS(
+      mStats.offset = mRotationReport.offset;
+      mStats.minDist = mRotationReport.cost;
+      mStats.totalNs = lap(start);
+      if ( const SetupStatsHook hook = setupStatsHook() )
+        hook(mStats);
+    )
   }
+  dirty = false;
 }
 
+template <typename T>
+void BasicSingleInterpolator<T>::resample(const ShapeType &shape, ShapeType &ring) const
+{
+  ring.assign(shape.cbegin(), shape.cend());
+  if ( mResampling == ResamplingMethod::Curvature )
+    simplify::resample(ring, mMsl, mMaxPoints);
+  else
+    ring.normalize(mMsl, mMaxPoints);
+}
+
+template <typename T>
+unsigned BasicSingleInterpolator<T>::rotate(const Point *from, const Point *to, unsigned n)
+{
+  // the offset of the previous setup bounds the search, and is close to the best one when a
+  // single side changed a little, e.g. a target moving along an animation
+  float bound = 0.f;
+  const unsigned offset = rotation::find(mRotation, from, to, n, mThreads, mDecimation, mCandidates, &bound,
+                                         mRotationReport.offset, resource());
+
+  mRotationReport.offset = offset;
+  mRotationReport.cost = rotation::cost(from, to, n, offset);
+  // float rounding of either sum must not put the bound above the cost
+  mRotationReport.bound = mRotation == RotationMethod::Approximate ? std::min(bound, mRotationReport.cost)
+                                                                   : mRotationReport.cost;
+  return offset;
+}
+
+template class BasicSingleInterpolator<float>;
+template class BasicSingleInterpolator<double>;
+
 }
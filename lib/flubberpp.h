@@ -11,42 +11,455 @@
 #endif
 
 #include "shape.h"
+#include "aligned.h"
+#include "morph.h"
+#include "arena.h"
+#include "threadpool.h"
+#include "stats.h"
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
 
 namespace flubberpp {
 
-/** One to One shape interpolator */
-class FLUBBERPP_EXPORT SingleInterpolator {
+/** Method used to find the rotation of the 'from' shape that best matches the 'to' shape */
+enum class RotationMethod {
+  BruteForce, /**< tries every start offset, O(N²) */
+  Fft,        /**< circular cross-correlation through FFT, O(N log N). Exact optimum, may differ from
+                   BruteForce only between offsets whose costs tie within float rounding */
+  Approximate /**< coarse to fine search. Not guaranteed optimal, see RotationReport */
+};
+
+/** Outcome of the last rotation search */
+struct FLUBBERPP_EXPORT RotationReport {
+  /** Chosen start offset of the 'from' shape */
+  unsigned offset = 0;
+  /** Sum of square distances at the chosen offset */
+  float cost = 0.f;
+  /** Lower bound of the best achievable cost: equal to @c cost for exact methods. For
+   *  RotationMethod::Approximate, the best coarse cost minus the error of decimating, see
+   *  rotation::approximate(). cost/bound bounds the error, use RotationMethod::Fft when
+   *  it is too large */
+  float bound = 0.f;
+};
+
+/** How the shapes are resampled before being paired */
+enum class ResamplingMethod {
+  Uniform,  /**< Shape::normalize(): every segment is split down to maxSegmentLength */
+  Curvature /**< simplify::resample(): nearly collinear points are dropped and straight runs
+                 are split less than corners, within the point budget */
+};
+
+/** Outcome of the last resampling */
+struct FLUBBERPP_EXPORT ResamplingReport {
+  /** Points of each shape of the prepared morph */
+  std::size_t points = 0;
+  /** Points ResamplingMethod::Uniform gives without budget, from Shape::normalizedSizeBound() */
+  std::size_t uniformPoints = 0;
+
+  /** Points saved against ResamplingMethod::Uniform */
+  std::size_t saved() const { return uniformPoints > points ? uniformPoints - points : 0; }
+};
+
+/** A bounded, thread safe, least recently used cache of prepared interpolations, addressed by
+ *  the content of their shapes and settings. SingleInterpolator looks its setups up in
+ *  MorphCache::global() unless told otherwise, so that morphing the same shapes again is free
+ */
+class FLUBBERPP_EXPORT MorphCache {
   public:
-    /** Builds a shape interpolator starting from shape 'from' and ending in shape 'to' */
-    SingleInterpolator(const VectorShape &from, const VectorShape &to, float maxSegmentLength = 10.f);
+    /** 128 bits content hash */
+    struct Key {
+      std::uint64_t a = 0, b = 0;
+      bool operator==(const Key &o) const { return a == o.a && b == o.b; }
+    };
+
+    /** A cached setup */
+    struct Entry {
+      std::shared_ptr<const PreparedMorph> morph;
+      RotationReport report;
+      ResamplingReport resampling;
+      // the morph is relative to this point
+      PointD origin { 0., 0. };
+    };
+
+    /** Keeps the least recently used entries within @c budget bytes of prepared morphs */
+    explicit MorphCache(std::size_t budget = 32*1024*1024);
+
+    MorphCache(const MorphCache &) = delete;
+    MorphCache &operator=(const MorphCache &) = delete;
+
+    /** The cache used by default by all the interpolators */
+    static MorphCache &global();
 
-    SingleInterpolator(float maxSegmentLength = 10.f);
+    /** Hashes the points of a shape */
+    static Key hash(const VectorShape &s);
+    static Key hash(const VectorShapeD &s);
+    /** Key of the setup of shapes hashed to @c from and @c to, with the given settings */
+    static Key key(const Key &from, const Key &to, double maxSegmentLength, RotationMethod method,
+                   unsigned decimation, unsigned candidates,
+                   ResamplingMethod resampling = ResamplingMethod::Uniform, std::size_t maxPoints = 0);
+
+    /** Looks up @c key, making it the most recently used entry. Returns false on miss */
+    bool find(const Key &key, Entry &entry);
+    /** Adds or replaces the entry of @c key, then evicts the least recently used entries
+     *  beyond the budget. Entries larger than the budget are not kept */
+    void insert(const Key &key, const Entry &entry);
+
+    /** Removes all the entries. Counters are kept */
+    void clear();
+
+    /** Changes the memory budget, evicting entries if needed */
+    void setBudget(std::size_t budget);
+    std::size_t budget() const;
+
+    /** Bytes of prepared morphs currently held */
+    std::size_t bytes() const;
+    /** Number of entries */
+    std::size_t size() const;
+    /** Number of successful/failed lookups since construction */
+    std::size_t hits() const;
+    std::size_t misses() const;
+
+  private:
+    struct KeyHash {
+      std::size_t operator()(const Key &k) const { return std::size_t(k.a); }
+    };
+    using List = std::list<std::pair<Key,Entry>>;
+
+    void evict();
+
+    mutable std::mutex mMutex;
+    std::size_t mBudget, mBytes;
+    std::size_t mHits, mMisses;
+    // most recently used first
+    List mEntries;
+    std::unordered_map<Key,List::iterator,KeyHash> mIndex;
+};
+
+/** One to One shape interpolator.
+ *  The shapes are set up (normalized, padded and rotated) with coordinates of type T, float or
+ *  double, and evaluated in float. With double, the prepared morph is expressed relative to
+ *  origin(), the center of both shapes, so that large coordinates such as projected geographic
+ *  ones keep their precision; at() adds origin() back
+ */
+template <typename T>
+class FLUBBERPP_EXPORT BasicSingleInterpolator {
+  public:
+    using PointType = BasicPoint<T>;
+    using ShapeType = Shape<std::vector, std::allocator<PointType>>;
+
+    /** Builds a shape interpolator starting from shape 'from' and ending in shape 'to'.
+     *  Temporary buffers of the setup are allocated from @c mr
+     */
+    BasicSingleInterpolator(const ShapeType &from, const ShapeType &to, T maxSegmentLength = 10,
+                            std::pmr::memory_resource *mr = std::pmr::get_default_resource());
 
-    void setStartShape(const VectorShape &s);
-    void setEndShape(const VectorShape &s);
+    BasicSingleInterpolator(T maxSegmentLength = 10,
+                            std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+    /** Replaces one of the shapes. The next setup resamples only that side, pads the other one
+     *  again only if the padded size changes, and seeds the rotation search with the previous
+     *  offset, see rotation::find()
+     */
+    void setStartShape(const ShapeType &s);
+    void setEndShape(const ShapeType &s);
+
+    /** Allocates the temporary buffers of the setup from @c mr, e.g. a per job BumpArena.
+     *  The prepared morph and the shapes kept for the next setup are not allocated from it,
+     *  so the arena can be reset as soon as the interpolator is set up (see prepared()) or
+     *  destroyed
+     */
+    void setMemoryResource(std::pmr::memory_resource *mr);
+    std::pmr::memory_resource *memoryResource() const { return mMr; }
+
+    /** Selects the rotation search method. Applies to the next setup of the shapes */
+    void setRotationMethod(RotationMethod method);
+    RotationMethod rotationMethod() const { return mRotation; }
+
+    /** Tunes RotationMethod::Approximate: keep one point every @c decimation points for the
+     *  coarse search (0 = automatic) and refine around the @c candidates best coarse offsets
+     */
+    void setApproximation(unsigned decimation, unsigned candidates = 4);
+
+    /** Outcome of the last rotation search */
+    const RotationReport &rotationReport() const { return mRotationReport; }
+
+    /** Selects how the shapes are resampled. Applies to the next setup of the shapes */
+    void setResampling(ResamplingMethod method);
+    ResamplingMethod resampling() const { return mResampling; }
+
+    /** Caps the points of each shape, and so of the prepared morph, to @c maxPoints whatever
+     *  the input geometry and maxSegmentLength, 0 = no cap. Uniform resampling then splits the
+     *  segments less, see Shape::normalize(). Applies to the next setup of the shapes */
+    void setMaxPoints(std::size_t maxPoints);
+    std::size_t maxPoints() const { return mMaxPoints; }
+
+    /** Outcome of the last resampling: points of the prepared morph against the uniform ones */
+    const ResamplingReport &resamplingReport() const { return mResamplingReport; }
+
+    /** Looks setups up in @c cache and stores them there, nullptr disables caching.
+     *  Defaults to MorphCache::global() */
+    void setCache(MorphCache *cache) { mCache = cache; }
+    MorphCache *cache() const { return mCache; }
+
+    /** Number of worker threads used by the brute force rotation search. Defaults to 1 */
+    void setThreadCount(unsigned threads);
+    unsigned threadCount() const { return mThreads; }
 
     /** Returns the interpolated shape at time dt between 0 and 1 */
-    const VectorShape &at(float dt);
+    const ShapeType &at(float dt);
+
+    /** Same as at(), but returns the interpolated coordinates as separate x and y arrays.
+     *  This avoids interleaving them into a shape. Coordinates are relative to origin().
+     *  Valid until the next call
+     */
+    XYSpan atXY(float dt);
+
+    /** Builds the level of detail hierarchy of the prepared morph at setup, see MorphLevels,
+     *  so that at(dt, tolerance) evaluates only the points it needs. Off by default */
+    void setLevelsOfDetail(bool enabled);
+    bool levelsOfDetail() const { return mLevelsOfDetail; }
+
+    /** Same as at(), but with only the points of the coarsest level of detail that stays within
+     *  about @c tolerance of the shape, e.g. a pixel in shape units, so that the cost follows the
+     *  size on screen rather than the resolution of the shapes. All the points without levels
+     */
+    const ShapeType &at(float dt, float tolerance);
+
+    /** Same as atXY() with levels of detail */
+    XYSpan atXY(float dt, float tolerance);
+
+    /** Returns the prepared interpolation, which can be shared and evaluated concurrently.
+     *  It is not affected by later changes of this interpolator. Relative to origin()
+     */
+    std::shared_ptr<const PreparedMorph> prepared();
+
+    /** Origin of the prepared interpolation: (0,0) for float, the center of the bounding box
+     *  of both shapes for double
+     */
+    PointType origin();
+
+#ifdef FLUBBERPP_ENABLE_STATS
+    /** Statistics of the last setup, see also setSetupStatsHook() */
+    const SetupStats &setupStats() const { return mStats; }
+#endif
 
   private:
     void setup();
 
-    /** Rotates the 'from' shape so as to minimize the sum of square distances
-     *  between its points and the points of the 'to' shape
+    /** Resamples @c shape into @c ring with the current settings */
+    void resample(const ShapeType &shape, ShapeType &ring) const;
+
+    /** Resource the setup allocates from */
+#ifdef FLUBBERPP_ENABLE_STATS
+    std::pmr::memory_resource *resource() { return &mCounter; }
+#else
+    std::pmr::memory_resource *resource() { return mMr; }
+#endif
+
+    /** Finds the rotation of the 'from' shape minimizing the sum of square distances
+     *  between its points and the points of the 'to' shape, and returns its start offset.
      *  This is used to reorder the points of the 'from' shape
      *  so that overall the distance traveled between points of the
      *  'from' shape to reach 'to' shape is minimal
      */
-    void rotate(ListShape &from, const ListShape &to);
+    unsigned rotate(const Point *from, const Point *to, unsigned n);
+
+    T mMsl;
+    std::pmr::memory_resource *mMr;
+    RotationMethod mRotation;
+    unsigned mThreads;
+    unsigned mDecimation, mCandidates;
+    RotationReport mRotationReport;
+    ResamplingMethod mResampling;
+    std::size_t mMaxPoints;
+    ResamplingReport mResamplingReport;
+    MorphCache *mCache;
+#ifdef FLUBBERPP_ENABLE_STATS
+    // counts the setup allocations made from mMr
+    CountingResource mCounter { mMr };
+    SetupStats mStats;
+#endif
+    // shapes as given and their hashes, computed on setup when caching, the same shapes
+    // resampled, and padded to the same size. They are kept across setups, so that changing one
+    // side hashes, resamples and pads only that side, and are not allocated from mMr, which can
+    // be reset once the interpolator is set up
+    ShapeType mFromShape, mToShape;
+    MorphCache::Key mFromKey, mToKey;
+    bool mFromHashed, mToHashed;
+    ShapeType mFromRing, mToRing;
+    bool mFromResampled, mToResampled;
+    ShapeType mFromPadded, mToPadded;
+    std::shared_ptr<const PreparedMorph> mMorph;
+    PointType mOrigin;
+    bool mLevelsOfDetail;
+    MorphLevels mLevels;
+    AlignedFloats mCurX, mCurY;
+    // full and level of detail interpolated shapes
+    ShapeType mCur, mLodCur;
+    bool dirty;
+};
+
+/** Float shape interpolator */
+using SingleInterpolator = BasicSingleInterpolator<float>;
+/** Shape interpolator set up in double precision */
+using SingleInterpolatorD = BasicSingleInterpolator<double>;
+
+extern template class BasicSingleInterpolator<float>;
+extern template class BasicSingleInterpolator<double>;
+
+/** Chained interpolation through keyframe shapes A -> B -> C ... The K keyframes are normalized
+ *  once, each one being shared by the transitions before and after it, and the K-1 transitions
+ *  are prepared up front. Transition i covers the global times [i/(K-1), (i+1)/(K-1)]
+ */
+class FLUBBERPP_EXPORT MorphTimeline {
+  public:
+    MorphTimeline(const std::vector<VectorShape> &keyframes, float maxSegmentLength = 10.f,
+                  RotationMethod method = RotationMethod::BruteForce);
+
+    /** Number of transitions */
+    size_t size() const { return mMorphs.size(); }
+
+    /** Prepared transition from keyframe i to keyframe i+1 */
+    std::shared_ptr<const PreparedMorph> transition(size_t i) const { return mMorphs[i]; }
+
+    /** Returns the interpolated shape at global time t between 0 and 1 */
+    const VectorShape &at(float t);
 
-    /** Cuts the shape into triangles using the earcut method. Returns a sorted set
-     *  wrt to areas */
-    VectorShapeSet triangulate(const VectorShape &s) const;
+    /** Same as at(), as separate x and y arrays. Valid until the next call */
+    XYSpan atXY(float t);
+
+  private:
+    std::vector<std::shared_ptr<const PreparedMorph>> mMorphs;
+    AlignedFloats mCurX, mCurY;
+    VectorShape mCur;
+};
+
+/** Base of the interpolators between several shapes. All the interpolated shapes are
+ *  evaluated in a single pass into one contiguous buffer, so they can be drawn at once
+ */
+class FLUBBERPP_EXPORT MultiInterpolator {
+  public:
+    /** Number of interpolated shapes */
+    size_t size() const { return mCur.size(); }
+
+    /** Returns the interpolated shapes at time dt between 0 and 1 */
+    const PackedShapes &at(float dt);
+
+    /** Returns the prepared interpolation of all the shapes, concatenated in the order of at() */
+    std::shared_ptr<const PreparedMorph> prepared() const { return mMorph; }
+
+  protected:
+    /** Concatenates the prepared interpolations of the shapes */
+    void setMorphs(const std::vector<std::shared_ptr<const PreparedMorph>> &morphs);
+
+    /** Pairs the pieces of @c whole, cut in as many pieces as there are @c parts, with
+     *  @c parts: returns the piece matching each part
+     */
+    static std::vector<VectorShape> cutLike(const VectorShape &whole, const std::vector<VectorShape> &parts,
+                                            float maxSegmentLength);
+
+  private:
+    std::shared_ptr<const PreparedMorph> mMorph;
+    PackedShapes mCur;
+};
+
+/** One to Many shape interpolator: the 'from' shape is cut into as many pieces of balanced
+ *  areas as there are 'to' shapes, and each piece is interpolated into one of them
+ */
+class FLUBBERPP_EXPORT SeparateInterpolator : public MultiInterpolator {
+  public:
+    /** Builds an interpolator splitting shape 'from' into shapes 'to'. at() gives the shapes
+     *  in the order of 'to' */
+    SeparateInterpolator(const VectorShape &from, const std::vector<VectorShape> &to, float maxSegmentLength = 10.f);
+};
+
+/** Many to One shape interpolator: the 'to' shape is cut into as many pieces of balanced
+ *  areas as there are 'from' shapes, and each 'from' shape is interpolated into one of them
+ */
+class FLUBBERPP_EXPORT CombineInterpolator : public MultiInterpolator {
+  public:
+    /** Builds an interpolator merging shapes 'from' into shape 'to'. at() gives the shapes
+     *  in the order of 'from' */
+    CombineInterpolator(const std::vector<VectorShape> &from, const VectorShape &to, float maxSegmentLength = 10.f);
+};
+
+/** M to N shape interpolator. Shapes are paired so as to minimize the overall travel cost
+ *  (distance between centroids and difference of sizes). When there are more 'to' shapes,
+ *  each surplus one is cut out of the 'from' shape nearest to it, and the other way around
+ *  when there are more 'from' shapes
+ */
+class FLUBBERPP_EXPORT AllInterpolator : public MultiInterpolator {
+  public:
+    /** Builds an interpolator from shapes 'from' to shapes 'to'. at() gives max(M,N) shapes,
+     *  in the order of the larger of 'from' and 'to' */
+    AllInterpolator(const std::vector<VectorShape> &from, const std::vector<VectorShape> &to, float maxSegmentLength = 10.f);
+};
+
+/** Prepares and evaluates many independent one to one interpolations in parallel */
+class FLUBBERPP_EXPORT MorphBatch {
+  public:
+    /** Uses @c threads threads, the calling one included */
+    explicit MorphBatch(float maxSegmentLength = 10.f, unsigned threads = std::thread::hardware_concurrency());
+
+    /** Adds an interpolation from shape 'from' to shape 'to'. Takes effect on prepare() */
+    void add(const VectorShape &from, const VectorShape &to);
+
+    /** Selects the rotation search method of all the interpolations */
+    void setRotationMethod(RotationMethod method) { mRotation = method; }
+
+    /** Evaluates at() from 16 bits quantized copies of the interpolations, streaming half the
+     *  bytes for an error of at most QuantizedMorph::maxError() per coordinate.
+     *  Takes effect on prepare() or load()
+     */
+    void setQuantized(bool quantized) { mQuantized = quantized; }
+    bool quantized() const { return mQuantized; }
+
+    /** Prepares the added interpolations on the thread pool, the most expensive ones first:
+     *  their cost is estimated from the number of points after normalization.
+     *  They bypass the setup cache
+     */
+    void prepare();
+
+    /** Number of interpolations */
+    size_t size() const { return mMorphs.size(); }
+
+    /** Prepared interpolation i */
+    std::shared_ptr<const PreparedMorph> morph(size_t i) const { return mMorphs[i]; }
+
+    /** Writes the prepared interpolations to file @c path (see serialize.h), calling prepare()
+     *  if needed. Returns false on I/O error */
+    bool save(const std::string &path);
+
+    /** Replaces all the interpolations by the ones of file @c path written by save(). They are
+     *  evaluated from the mapped file. Returns false if the file can't be loaded, leaving
+     *  the batch unchanged */
+    bool load(const std::string &path);
+
+    /** Evaluates all the interpolations at time dt between 0 and 1 in parallel, into a single
+     *  buffer: shape i is the interpolation i. Calls prepare() if needed
+     */
+    const PackedShapes &at(float dt);
+
+  private:
+    /** Computes the output layout and the tasks of at() */
+    void layout();
 
     float mMsl;
-    ListShape mFromList, mToList;
-    VectorShape mFrom, mTo, mCur;
-    bool dirty;
+    RotationMethod mRotation;
+    bool mQuantized;
+    ThreadPool mPool;
+    std::vector<std::pair<VectorShape,VectorShape>> mPairs;
+    std::vector<std::shared_ptr<const PreparedMorph>> mMorphs;
+    // quantized copies of mMorphs evaluated by at(), if enabled
+    std::vector<QuantizedMorph> mQuantizedMorphs;
+    // consecutive interpolations evaluated by each task of at()
+    std::vector<size_t> mTasks;
+    PackedShapes mCur;
 };
 
 };
@@ -0,0 +1,93 @@
+#include "lerp.h"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace flubberpp {
+
+void lerp(const float *from, const float *delta, float *out, std::size_t n, float dt)
+{
+  std::size_t i = 0;
+
+#if defined(__AVX__)
+  const __m256 t = _mm256_set1_ps(dt);
+  for (; i+8<=n; i+=8) {
+    const __m256 a = _mm256_loadu_ps(from+i);
+    const __m256 d = _mm256_loadu_ps(delta+i);
+#if defined(__FMA__)
+    _mm256_storeu_ps(out+i, _mm256_fmadd_ps(d, t, a));
+#else
+    _mm256_storeu_ps(out+i, _mm256_add_ps(a, _mm256_mul_ps(d, t)));
+#endif
+  }
+#elif defined(__ARM_NEON)
+  const float32x4_t t = vdupq_n_f32(dt);
+  for (; i+4<=n; i+=4) {
+    vst1q_f32(out+i, vfmaq_f32(vld1q_f32(from+i), vld1q_f32(delta+i), t));
+  }
+#endif
+
+  // scalar fallback and remaining points, left to the auto vectorizer on plain SSE builds
+  for (; i<n; i++) {
+    out[i] = from[i] + delta[i]*dt;
+  }
+}
+
+void lerp(const std::int16_t *from, const std::int16_t *to, float *out, std::size_t n,
+          float offset, float fromScale, float toScale)
+{
+  std::size_t i = 0;
+
+#if defined(__AVX2__)
+  const __m256 o = _mm256_set1_ps(offset);
+  const __m256 fs = _mm256_set1_ps(fromScale);
+  const __m256 ts = _mm256_set1_ps(toScale);
+  for (; i+8<=n; i+=8) {
+    const __m256 f = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(from+i))));
+    const __m256 t = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(to+i))));
+#if defined(__FMA__)
+    _mm256_storeu_ps(out+i, _mm256_fmadd_ps(t, ts, _mm256_fmadd_ps(f, fs, o)));
+#else
+    _mm256_storeu_ps(out+i, _mm256_add_ps(_mm256_add_ps(o, _mm256_mul_ps(f, fs)), _mm256_mul_ps(t, ts)));
+#endif
+  }
+#elif defined(__SSE2__)
+  const __m128 o = _mm_set1_ps(offset);
+  const __m128 fs = _mm_set1_ps(fromScale);
+  const __m128 ts = _mm_set1_ps(toScale);
+  for (; i+8<=n; i+=8) {
+    // sign extends by unpacking each int16 in the high half of an int32 then shifting it down
+    const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i*>(from+i));
+    const __m128i t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(to+i));
+    const __m128 flo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(f, f), 16));
+    const __m128 fhi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(f, f), 16));
+    const __m128 tlo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(t, t), 16));
+    const __m128 thi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(t, t), 16));
+    _mm_storeu_ps(out+i, _mm_add_ps(_mm_add_ps(o, _mm_mul_ps(flo, fs)), _mm_mul_ps(tlo, ts)));
+    _mm_storeu_ps(out+i+4, _mm_add_ps(_mm_add_ps(o, _mm_mul_ps(fhi, fs)), _mm_mul_ps(thi, ts)));
+  }
+#elif defined(__ARM_NEON)
+  const float32x4_t o = vdupq_n_f32(offset);
+  for (; i+8<=n; i+=8) {
+    const int16x8_t f = vld1q_s16(from+i);
+    const int16x8_t t = vld1q_s16(to+i);
+    const float32x4_t flo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(f)));
+    const float32x4_t fhi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(f)));
+    const float32x4_t tlo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(t)));
+    const float32x4_t thi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(t)));
+    vst1q_f32(out+i, vfmaq_n_f32(vfmaq_n_f32(o, flo, fromScale), tlo, toScale));
+    vst1q_f32(out+i+4, vfmaq_n_f32(vfmaq_n_f32(o, fhi, fromScale), thi, toScale));
+  }
+#endif
+
+  for (; i<n; i++) {
+    out[i] = offset + from[i]*fromScale + to[i]*toScale;
+  }
+}
+
+}
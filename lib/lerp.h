@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace flubberpp {
+
+/** out[i] = from[i] + delta[i]*dt for i in [0,n[. Uses FMA with AVX2/NEON when available.
+ *  Pointers need no particular alignment, but aligned ones are faster
+ */
+void lerp(const float *from, const float *delta, float *out, std::size_t n, float dt);
+
+/** out[i] = offset + from[i]*fromScale + to[i]*toScale for i in [0,n[, i.e. the interpolation
+ *  of quantized coordinates, with the scales premultiplied by 1-dt and dt
+ */
+void lerp(const std::int16_t *from, const std::int16_t *to, float *out, std::size_t n,
+          float offset, float fromScale, float toScale);
+
+}
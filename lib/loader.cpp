@@ -0,0 +1,228 @@
+#include "loader.h"
+#include "mappedfile.h"
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace flubberpp {
+
+namespace {
+
+/** Index of the lowest set bit of @c v, which is not 0 */
+inline unsigned trailingZeros(std::uint64_t v)
+{
+#if defined(__GNUC__)
+  return unsigned(__builtin_ctzll(v));
+#else
+  unsigned n = 0;
+  for (; !(v & 1); v >>= 1)
+    n++;
+  return n;
+#endif
+}
+
+/** Appends the decimal digits from @c c to @c mantissa, up to 8 at a time while the text has
+ *  8 more bytes, returning the end of the digits. Digits past the 19th overflow.
+ *  Meant for long runs such as fractions: a short run costs more than a plain loop
+ */
+const char *digits(const char *c, const char *end, std::uint64_t &mantissa)
+{
+#if !defined(__BYTE_ORDER__) || __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  static constexpr std::uint64_t scale[] = { 1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000 };
+  while ( end - c >= 8 ) {
+    std::uint64_t chunk;
+    std::memcpy(&chunk, c, sizeof(chunk));
+    // bytes in '0'..'9' have a high nibble of 3, still 3 once 6 is added: the others are not
+    // 0 after the xor. The first of them ends the digits
+    const std::uint64_t other = ((chunk & 0xF0F0F0F0F0F0F0F0) | (((chunk + 0x0606060606060606) & 0xF0F0F0F0F0F0F0F0) >> 4))
+                                ^ 0x3333333333333333;
+    const std::uint64_t ends = (((other & 0x7F7F7F7F7F7F7F7F) + 0x7F7F7F7F7F7F7F7F) | other) & 0x8080808080808080;
+    const unsigned count = ends ? trailingZeros(ends) / 8 : 8;
+    if ( !count )
+      return c;
+    // the digits, first one in the low byte, are moved up behind zeros, then combined by
+    // pairs, quads and all 8
+    chunk = (chunk - 0x3030303030303030) << (8 * (8 - count));
+    chunk = chunk*10 + (chunk >> 8);
+    chunk = ((chunk & 0x000000FF000000FF) * (100 + (1000000ull << 32)) +
+             ((chunk >> 16) & 0x000000FF000000FF) * (1 + (10000ull << 32))) >> 32;
+    mantissa = mantissa*scale[count] + chunk;
+    c += count;
+    if ( count < 8 )
+      return c;
+  }
+#endif
+  for (; c < end && unsigned(*c - '0') < 10; c++)
+    mantissa = mantissa*10 + unsigned(*c - '0');
+  return c;
+}
+
+/** Fast path of number parsing for -ddd.ddde-dd with up to 19 digits, which covers the
+ *  datasets. The digits are read into an integer, then scaled once by an exact power of ten
+ *  in double: the result is within 2 ulps of the exact value. Returns the end of the number,
+ *  or nullptr when it can't tell how the value rounds to float, or for any other syntax, for
+ *  from_chars() to decide
+ */
+const char *decimal(const char *c, const char *end, float &v)
+{
+  static constexpr double powers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10,
+    1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+  };
+  const bool negative = c < end && *c == '-';
+  if ( negative )
+    c++;
+
+  std::uint64_t mantissa = 0;
+  int exponent = 0;
+  // integral parts are short, fractions use digits()
+  const char *start = c;
+  for (; c < end && unsigned(*c - '0') < 10; c++)
+    mantissa = mantissa*10 + unsigned(*c - '0');
+  if ( c == start )
+    return nullptr;
+  int count = int(c - start);
+  if ( c < end && *c == '.' ) {
+    start = ++c;
+    c = digits(c, end, mantissa);
+    if ( c == start )
+      return nullptr;
+    count += int(c - start);
+    exponent = -int(c - start);
+  }
+  if ( c < end && (*c == 'e' || *c == 'E') ) {
+    c++;
+    const bool negativeExponent = c < end && *c == '-';
+    if ( c < end && (*c == '-' || *c == '+') )
+      c++;
+    int e = 0;
+    start = c;
+    for (; c < end && unsigned(*c - '0') < 10 && e < 1000; c++)
+      e = e*10 + (*c - '0');
+    if ( c == start || (c < end && unsigned(*c - '0') < 10) )
+      return nullptr;
+    exponent += negativeExponent ? -e : e;
+  }
+  if ( count > 19 || exponent < -22 || exponent > 22 )
+    return nullptr;
+
+  double value = double(mantissa);
+  value = exponent < 0 ? value / powers[-exponent] : value * powers[exponent];
+  // a float has 29 bits less than a double: values next to the middle of two floats may
+  // round either way
+  std::uint64_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  const std::uint64_t low = bits & ((std::uint64_t(1) << 29) - 1);
+  const std::uint64_t half = std::uint64_t(1) << 28;
+  if ( (low > half ? low - half : half - low) <= 4 || value > std::numeric_limits<float>::max() )
+    return nullptr;
+
+  v = float(negative ? -value : value);
+  return c;
+}
+
+/** Cursor over the text, failing for good on the first unexpected character */
+class Parser {
+  public:
+    explicit Parser(std::string_view text) : mCur(text.data()), mEnd(text.data() + text.size()) {}
+
+    /** Skips spaces, tabs and line breaks, and also lets other control characters through */
+    void skipSpaces() {
+      while ( mCur < mEnd && static_cast<unsigned char>(*mCur) <= ' ' )
+        mCur++;
+    }
+
+    /** Consumes character c, after spaces */
+    bool expect(char c) {
+      skipSpaces();
+      if ( mCur < mEnd && *mCur == c ) {
+        mCur++;
+        return true;
+      }
+      return false;
+    }
+
+    bool number(float &v) {
+      skipSpaces();
+      if ( const char *end = decimal(mCur, mEnd, v) ) {
+        mCur = end;
+        return true;
+      }
+      const auto [end, err] = std::from_chars(mCur, mEnd, v);
+      if ( err != std::errc() )
+        return false;
+      mCur = end;
+      return true;
+    }
+
+    bool atEnd() {
+      skipSpaces();
+      return mCur == mEnd;
+    }
+
+  private:
+    const char *mCur, *mEnd;
+};
+
+/** Parses [x,y] */
+bool point(Parser &p, std::vector<Point> &points)
+{
+  Point pt;
+  if ( !p.expect('[') || !p.number(pt.x) || !p.expect(',') || !p.number(pt.y) || !p.expect(']') )
+    return false;
+  points.push_back(pt);
+  return true;
+}
+
+/** Parses [point,...] */
+bool shape(Parser &p, PackedShapes &shapes)
+{
+  if ( !p.expect('[') )
+    return false;
+  if ( !p.expect(']') ) {
+    do {
+      if ( !point(p, shapes.points) )
+        return false;
+    } while ( p.expect(',') );
+    if ( !p.expect(']') )
+      return false;
+  }
+  shapes.offsets.push_back(shapes.points.size());
+  return true;
+}
+
+}
+
+bool parseShapes(std::string_view text, PackedShapes &shapes)
+{
+  shapes.points.clear();
+  shapes.offsets.assign(1, 0);
+  // about 20 bytes per point in the datasets, rather over reserve than grow
+  shapes.points.reserve(text.size() / 16);
+
+  Parser p(text);
+  if ( !p.expect('[') )
+    return false;
+  if ( !p.expect(']') ) {
+    do {
+      if ( !shape(p, shapes) )
+        return false;
+    } while ( p.expect(',') );
+    if ( !p.expect(']') )
+      return false;
+  }
+  return p.atEnd();
+}
+
+bool loadShapes(const std::string &path, PackedShapes &shapes)
+{
+  MappedFile file;
+  if ( !file.open(path) )
+    return false;
+
+  return parseShapes(std::string_view(reinterpret_cast<const char*>(file.data()), file.size()), shapes);
+}
+
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#ifdef FLUBBERPP_LIBRARY
+#if _WIN32
+#define FLUBBERPP_EXPORT __declspec(dllexport)
+#else
+#define FLUBBERPP_EXPORT __attribute__((visibility("default")))
+#endif
+#else
+#define FLUBBERPP_EXPORT
+#endif
+
+#include "shape.h"
+
+#include <string>
+#include <string_view>
+
+namespace flubberpp {
+
+/** Parses shapes in the JSON format of the demo datasets, an array of shapes, each one an array
+ *  of [x,y] points: [[[x,y],...],...]
+ *  The shapes replace the contents of @c shapes, whose buffers are reused.
+ *  Returns false on syntax error, leaving @c shapes with the shapes parsed so far
+ */
+FLUBBERPP_EXPORT bool parseShapes(std::string_view text, PackedShapes &shapes);
+
+/** Same as parseShapes() on the memory mapped file @c path. Returns false if the file can't be
+ *  read or parsed
+ */
+FLUBBERPP_EXPORT bool loadShapes(const std::string &path, PackedShapes &shapes);
+
+};
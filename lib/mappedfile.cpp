@@ -0,0 +1,57 @@
+#include "mappedfile.h"
+
+#include <fstream>
+
+#if !defined(_WIN32)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace flubberpp {
+
+MappedFile::~MappedFile()
+{
+#if !defined(_WIN32)
+  if ( mMapped )
+    munmap(mMapped, mSize);
+#endif
+}
+
+bool MappedFile::open(const std::string &path, bool map)
+{
+#if !defined(_WIN32)
+  if ( map ) {
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if ( fd < 0 )
+      return false;
+    struct stat st;
+    if ( fstat(fd, &st) == 0 && st.st_size > 0 ) {
+      void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if ( p != MAP_FAILED ) {
+        mMapped = p;
+        mSize = st.st_size;
+      }
+    }
+    close(fd);
+    if ( mMapped )
+      return true;
+  }
+#endif
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if ( !in )
+    return false;
+  mSize = in.tellg();
+  mCopy.resize((mSize + sizeof(float) - 1) / sizeof(float));
+  in.seekg(0);
+  return bool(in.read(reinterpret_cast<char*>(mCopy.data()), mSize));
+}
+
+const unsigned char *MappedFile::data() const
+{
+  return mMapped ? static_cast<const unsigned char*>(mMapped)
+                 : reinterpret_cast<const unsigned char*>(mCopy.data());
+}
+
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "aligned.h"
+
+#include <cstddef>
+#include <string>
+
+namespace flubberpp {
+
+/** A whole file in memory, read only: memory mapped when possible, else read into an aligned
+ *  buffer. Internal to the library
+ */
+class MappedFile {
+  public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /** Opens @c path, mapping it if @c map is true and the platform allows it.
+     *  Returns false if the file can't be read
+     */
+    bool open(const std::string &path, bool map = true);
+
+    /** File contents, aligned for floats */
+    const unsigned char *data() const;
+    std::size_t size() const { return mSize; }
+
+  private:
+    void *mMapped = nullptr;
+    std::size_t mSize = 0;
+    AlignedFloats mCopy;
+};
+
+}
@@ -0,0 +1,195 @@
+#include "morph.h"
+#include "lerp.h"
+
+#include <cmath>
+#include <thread>
+#include <vector>
+
+namespace flubberpp {
+
+namespace {
+
+// 4 source arrays of Block floats fit in L1 cache
+constexpr std::size_t Block = 1024;
+
+/** Quantizes v[0..n-1] into q over their range, so that v[i] ~ offset + q[i]*scale */
+void quantize(const float *v, std::size_t n, AlignedInt16s &q, float &offset, float &scale)
+{
+  q.assign(n, 0);
+  offset = scale = 0.f;
+  if ( !n )
+    return;
+
+  const auto [lo, hi] = std::minmax_element(v, v+n);
+  offset = *lo + (*hi-*lo)/2.f;
+  scale = (*hi-*lo) / 65534.f;
+  if ( scale > 0.f ) {
+    for (std::size_t i=0; i<n; i++) {
+      q[i] = std::int16_t(std::clamp(std::lround((v[i]-offset)/scale), -32767l, 32767l));
+    }
+  }
+}
+
+}
+
+PreparedMorph::PreparedMorph(const std::vector<std::shared_ptr<const PreparedMorph>> &parts)
+{
+  std::size_t n = 0;
+  for (const auto &p: parts)
+    n += p->size();
+
+  float *data = allocate(n);
+  std::size_t i = 0;
+  for (const auto &p: parts) {
+    std::copy_n(p->mFromX, p->size(), data + i);
+    std::copy_n(p->mFromY, p->size(), data + mStride + i);
+    std::copy_n(p->mDeltaX, p->size(), data + 2*mStride + i);
+    std::copy_n(p->mDeltaY, p->size(), data + 3*mStride + i);
+    i += p->size();
+  }
+}
+
+PreparedMorph::PreparedMorph(XYSpan from, XYSpan delta, std::shared_ptr<const void> storage)
+  : mSize(from.size)
+  , mFromX(from.x)
+  , mFromY(from.y)
+  , mDeltaX(delta.x)
+  , mDeltaY(delta.y)
+  , mStorage(std::move(storage))
+{
+}
+
+float *PreparedMorph::allocate(std::size_t n)
+{
+  // keep each array aligned for vector loads
+  mSize = n;
+  mStride = (n + 7) / 8 * 8;
+  auto storage = std::make_shared<AlignedFloats>(4*mStride);
+  float *data = storage->data();
+  mFromX = data;
+  mFromY = data + mStride;
+  mDeltaX = data + 2*mStride;
+  mDeltaY = data + 3*mStride;
+  mStorage = std::move(storage);
+  return data;
+}
+
+void PreparedMorph::at(float dt, std::size_t first, std::size_t count, float *x, float *y) const
+{
+  lerp(mFromX+first, mDeltaX+first, x, count, dt);
+  lerp(mFromY+first, mDeltaY+first, y, count, dt);
+}
+
+void PreparedMorph::atMany(const float *dts, std::size_t frames, float *x, float *y, unsigned threads) const
+{
+  const std::size_t n = size();
+
+  auto run = [this, n, dts, x, y](std::size_t firstFrame, std::size_t lastFrame) {
+    for (std::size_t first=0; first<n; first+=Block) {
+      const std::size_t count = std::min(Block, n-first);
+      for (std::size_t f=firstFrame; f<lastFrame; f++) {
+        at(dts[f], first, count, x + f*n + first, y + f*n + first);
+      }
+    }
+  };
+
+  threads = std::max(1u, std::min<unsigned>(threads, frames));
+  std::vector<std::thread> workers;
+  workers.reserve(threads-1);
+  for (unsigned t=1; t<threads; t++) {
+    workers.emplace_back(run, frames*t/threads, frames*(t+1)/threads);
+  }
+  run(0, frames/threads);
+  for (auto &w: workers)
+    w.join();
+}
+
+QuantizedMorph::QuantizedMorph(const PreparedMorph &morph)
+{
+  const XYSpan from = morph.from(), delta = morph.delta();
+  const std::size_t n = morph.size();
+  quantize(from.x, n, mFromX, mFromRangeX.offset, mFromRangeX.scale);
+  quantize(from.y, n, mFromY, mFromRangeY.offset, mFromRangeY.scale);
+
+  AlignedFloats to(n);
+  for (std::size_t i=0; i<n; i++)
+    to[i] = from.x[i] + delta.x[i];
+  quantize(to.data(), n, mToX, mToRangeX.offset, mToRangeX.scale);
+  for (std::size_t i=0; i<n; i++)
+    to[i] = from.y[i] + delta.y[i];
+  quantize(to.data(), n, mToY, mToRangeY.offset, mToRangeY.scale);
+}
+
+void QuantizedMorph::at(float dt, std::size_t first, std::size_t count, float *x, float *y) const
+{
+  // (1-dt)*(fo + f*fs) + dt*(to + t*ts)
+  lerp(mFromX.data()+first, mToX.data()+first, x, count,
+       (1.f-dt)*mFromRangeX.offset + dt*mToRangeX.offset, (1.f-dt)*mFromRangeX.scale, dt*mToRangeX.scale);
+  lerp(mFromY.data()+first, mToY.data()+first, y, count,
+       (1.f-dt)*mFromRangeY.offset + dt*mToRangeY.offset, (1.f-dt)*mFromRangeY.scale, dt*mToRangeY.scale);
+}
+
+float QuantizedMorph::maxError() const
+{
+  return std::max({ mFromRangeX.scale, mFromRangeY.scale, mToRangeX.scale, mToRangeY.scale }) / 2.f;
+}
+
+MorphLevels::MorphLevels(const PreparedMorph &morph)
+{
+  const XYSpan from = morph.from(), delta = morph.delta();
+  const std::size_t n = morph.size();
+  if ( !n )
+    return;
+
+  const auto triangle = [&from,&delta](std::size_t a, std::size_t b, std::size_t c) {
+    const Point fa { from.x[a], from.y[a] }, fb { from.x[b], from.y[b] }, fc { from.x[c], from.y[c] };
+    const Point ta { fa.x + delta.x[a], fa.y + delta.y[a] }, tb { fb.x + delta.x[b], fb.y + delta.y[b] },
+                tc { fc.x + delta.x[c], fc.y + delta.y[c] };
+    return std::max(simplify::triangleArea(fa, fb, fc), simplify::triangleArea(ta, tb, tc));
+  };
+  std::vector<double> area;
+  std::vector<std::size_t> order;
+  simplify::importance(n, triangle, area, order);
+
+  // rank of each point, the most important ones having the largest ranks
+  std::vector<std::size_t> rank(n);
+  for (std::size_t r=0; r<n; r++)
+    rank[order[r]] = r;
+
+  for (std::size_t keep=n; ; keep=std::max<std::size_t>(3, keep/2)) {
+    std::vector<std::uint32_t> indices;
+    indices.reserve(keep);
+    for (std::size_t i=0; i<n; i++) {
+      if ( rank[i] >= n-keep )
+        indices.push_back(std::uint32_t(i));
+    }
+    mIndices.push_back(std::move(indices));
+    mAreas.push_back(keep < n ? area[order[n-keep-1]] : 0.);
+    if ( keep <= 3 )
+      break;
+  }
+}
+
+std::size_t MorphLevels::level(float tolerance) const
+{
+  // areas grow with the levels
+  const double limit = double(tolerance) * tolerance;
+  std::size_t l = 0;
+  while ( l+1 < mAreas.size() && mAreas[l+1] <= limit )
+    l++;
+  return l;
+}
+
+std::size_t MorphLevels::at(const PreparedMorph &morph, float dt, std::size_t level, float *x, float *y) const
+{
+  const XYSpan from = morph.from(), delta = morph.delta();
+  const std::vector<std::uint32_t> &indices = mIndices[level];
+  for (std::size_t k=0; k<indices.size(); k++) {
+    const std::uint32_t i = indices[k];
+    x[k] = from.x[i] + dt*delta.x[i];
+    y[k] = from.y[i] + dt*delta.y[i];
+  }
+  return indices.size();
+}
+
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#ifdef FLUBBERPP_LIBRARY
+#if _WIN32
+#define FLUBBERPP_EXPORT __declspec(dllexport)
+#else
+#define FLUBBERPP_EXPORT __attribute__((visibility("default")))
+#endif
+#else
+#define FLUBBERPP_EXPORT
+#endif
+
+#include "shape.h"
+#include "aligned.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace flubberpp {
+
+/** Evaluates points [first,first+count[ of a morph by chunks in stack buffers, then
+ *  interleaves them into an output iterator of Point
+ */
+template <typename Morph, typename OutputIt>
+OutputIt interleave(const Morph &morph, float dt, std::size_t first, std::size_t count, OutputIt out)
+{
+  constexpr std::size_t Chunk = 256;
+  alignas(32) float x[Chunk], y[Chunk];
+  for (const std::size_t last=first+count; first<last; first+=Chunk) {
+    const std::size_t n = std::min(Chunk, last-first);
+    morph.at(dt, first, n, x, y);
+    for (std::size_t i=0; i<n; i++) {
+      *out++ = Point { x[i], y[i] };
+    }
+  }
+  return out;
+}
+
+/** The immutable result of preparing an interpolation: two shapes with the same number of
+ *  points, paired point to point.
+ *  All methods are const and write into caller supplied buffers, so that a single prepared
+ *  morph can be shared and evaluated by several threads at different times without locking
+ *  nor hidden allocations.
+ */
+class FLUBBERPP_EXPORT PreparedMorph {
+  public:
+    /** An empty morph */
+    PreparedMorph() = default;
+
+    /** Pairs the points of [fromBegin,fromEnd[ with the same number of points starting at toBegin */
+    template <typename It>
+    PreparedMorph(It fromBegin, It fromEnd, It toBegin) {
+      float *data = allocate(std::distance(fromBegin, fromEnd));
+      float *fromX = data, *fromY = data + mStride, *deltaX = data + 2*mStride, *deltaY = data + 3*mStride;
+      for (std::size_t i=0; fromBegin!=fromEnd; ++fromBegin, ++toBegin, ++i) {
+        fromX[i] = fromBegin->x;
+        fromY[i] = fromBegin->y;
+        deltaX[i] = toBegin->x - fromBegin->x;
+        deltaY[i] = toBegin->y - fromBegin->y;
+      }
+    }
+
+    /** Pairs two shapes of the same size */
+    PreparedMorph(const VectorShape &from, const VectorShape &to)
+      : PreparedMorph(from.cbegin(), from.cend(), to.cbegin()) {}
+
+    /** Concatenates several morphs into a single one, so that they are evaluated in one pass */
+    explicit PreparedMorph(const std::vector<std::shared_ptr<const PreparedMorph>> &parts);
+
+    /** A morph reading its coordinates from memory it doesn't own, e.g. a mapped file.
+     *  @c storage keeps this memory alive as long as the morph exists
+     */
+    PreparedMorph(XYSpan from, XYSpan delta, std::shared_ptr<const void> storage);
+
+    /** Number of points of the interpolated shape */
+    std::size_t size() const { return mSize; }
+
+    /** Writes the size() interpolated coordinates at time dt between 0 and 1 into x and y */
+    void at(float dt, float *x, float *y) const { at(dt, 0, size(), x, y); }
+
+    /** Writes the interpolated coordinates of points [first,first+count[ at time dt into x and y */
+    void at(float dt, std::size_t first, std::size_t count, float *x, float *y) const;
+
+    /** Writes the size() interpolated points at time dt to an output iterator of Point,
+     *  and returns the iterator past the last point written
+     */
+    template <typename OutputIt>
+    OutputIt at(float dt, OutputIt out) const { return at(dt, 0, size(), out); }
+
+    /** Writes the interpolated points [first,first+count[ at time dt to an output iterator */
+    template <typename OutputIt>
+    OutputIt at(float dt, std::size_t first, std::size_t count, OutputIt out) const {
+      return interleave(*this, dt, first, count, out);
+    }
+
+    /** Evaluates the morph at @c frames times dts[0..frames-1] at once, into frames x size()
+     *  matrices: the coordinates of frame f start at x + f*size() and y + f*size().
+     *  The points are processed by blocks that stay in cache across all the frames, so the
+     *  source buffers are read once instead of once per frame. Frames can be split over
+     *  several threads
+     */
+    void atMany(const float *dts, std::size_t frames, float *x, float *y, unsigned threads = 1) const;
+
+    /** The 'from' shape coordinates */
+    XYSpan from() const { return XYSpan { mFromX, mFromY, size() }; }
+    /** The 'to'-'from' displacement of each point */
+    XYSpan delta() const { return XYSpan { mDeltaX, mDeltaY, size() }; }
+
+  private:
+    /** Allocates aligned storage for the 4 arrays of n floats, each starting mStride floats
+     *  after the previous one. Returns the first one */
+    float *allocate(std::size_t n);
+
+    std::size_t mSize = 0, mStride = 0;
+    // 'from' coordinates and 'to'-'from' deltas, so that interpolating is a single multiply-add stream
+    const float *mFromX = nullptr, *mFromY = nullptr, *mDeltaX = nullptr, *mDeltaY = nullptr;
+    // owner of the arrays: our own aligned buffer or a mapped file
+    std::shared_ptr<const void> mStorage;
+};
+
+/** A prepared morph whose coordinates are stored as 16 bits integers, so that evaluating it
+ *  streams half the bytes of a PreparedMorph. Each axis of the 'from' and 'to' shapes is
+ *  quantized over its own range, with a step of 1/65534 of that range (see maxError()).
+ *  Same const, allocation free interface as PreparedMorph
+ */
+class FLUBBERPP_EXPORT QuantizedMorph {
+  public:
+    /** An empty morph */
+    QuantizedMorph() = default;
+
+    /** Quantizes a prepared morph */
+    explicit QuantizedMorph(const PreparedMorph &morph);
+
+    /** Number of points of the interpolated shape */
+    std::size_t size() const { return mFromX.size(); }
+
+    /** Writes the size() interpolated coordinates at time dt between 0 and 1 into x and y */
+    void at(float dt, float *x, float *y) const { at(dt, 0, size(), x, y); }
+
+    /** Writes the interpolated coordinates of points [first,first+count[ at time dt into x and y */
+    void at(float dt, std::size_t first, std::size_t count, float *x, float *y) const;
+
+    /** Writes the size() interpolated points at time dt to an output iterator of Point */
+    template <typename OutputIt>
+    OutputIt at(float dt, OutputIt out) const { return at(dt, 0, size(), out); }
+
+    /** Writes the interpolated points [first,first+count[ at time dt to an output iterator */
+    template <typename OutputIt>
+    OutputIt at(float dt, std::size_t first, std::size_t count, OutputIt out) const {
+      return interleave(*this, dt, first, count, out);
+    }
+
+    /** Largest distance along an axis between a quantized and an original coordinate */
+    float maxError() const;
+
+  private:
+    /** coordinate = offset + q*scale */
+    struct Range {
+      float offset = 0.f, scale = 0.f;
+    };
+
+    AlignedInt16s mFromX, mFromY, mToX, mToY;
+    Range mFromRangeX, mFromRangeY, mToRangeX, mToRangeY;
+};
+
+/** A level of detail hierarchy of a prepared morph, so that shapes rendered small are evaluated
+ *  with fewer points. The points are ranked by Visvalingam-Whyatt on both shapes at once: the
+ *  area of a point is the largest of its triangles in the 'from' and 'to' shapes, so that a
+ *  point that matters to either shape is kept all along the interpolation.
+ *  Each level keeps the most important half of the points of the previous one, down to 3
+ *  points, as a list of indices in ring order: the levels take twice the size of the indices
+ */
+class FLUBBERPP_EXPORT MorphLevels {
+  public:
+    /** No level */
+    MorphLevels() = default;
+
+    /** Ranks the points of @c morph and builds its levels */
+    explicit MorphLevels(const PreparedMorph &morph);
+
+    /** Number of levels, level 0 keeping all the points */
+    std::size_t size() const { return mIndices.size(); }
+
+    /** Indices of the points of a level, in ring order */
+    const std::vector<std::uint32_t> &indices(std::size_t level) const { return mIndices[level]; }
+
+    /** Coarsest level whose dropped points all have an area under tolerance², i.e. that stay
+     *  within about @c tolerance of the shapes */
+    std::size_t level(float tolerance) const;
+
+    /** Writes the interpolated coordinates of the points of a level at time dt into x and y,
+     *  and returns their number */
+    std::size_t at(const PreparedMorph &morph, float dt, std::size_t level, float *x, float *y) const;
+
+  private:
+    std::vector<std::vector<std::uint32_t>> mIndices;
+    // largest area of the points dropped by each level
+    std::vector<double> mAreas;
+};
+
+}
@@ -0,0 +1,180 @@
+#include "flubberpp.h"
+#include "triangulate.h"
+#include "assignment.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+namespace flubberpp {
+
+namespace {
+
+/** Pairs the 'start' shapes with the same number of 'end' shapes: start[order[i]] goes to end[i].
+ *  Like flubber, tries every permutation minimizing the squared distances between
+ *  centroids for up to 8 shapes. Beyond, solves the assignment problem
+ */
+std::vector<unsigned> pieceOrder(const std::vector<VectorShape> &start, const std::vector<VectorShape> &end)
+{
+  if ( start.size() > 8 ) {
+    std::vector<assignment::Descriptor> d1, d2;
+    for (const auto &s: end)
+      d1.push_back(assignment::describe(s));
+    for (const auto &s: start)
+      d2.push_back(assignment::describe(s));
+    return assignment::solve(d1, d2);
+  }
+
+  std::vector<unsigned> order(start.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  std::vector<Point> c1, c2;
+  for (const auto &s: start)
+    c1.push_back(s.centroid());
+  for (const auto &s: end)
+    c2.push_back(s.centroid());
+
+  std::vector<unsigned> best = order;
+  double bestDist = std::numeric_limits<double>::max();
+  do {
+    double dist = 0.;
+    for (size_t i=0; i<order.size(); i++) {
+      const Point d = c1[order[i]] - c2[i];
+      dist += double(d.x)*d.x + double(d.y)*d.y;
+    }
+    if ( dist < bestDist ) {
+      bestDist = dist;
+      best = order;
+    }
+  } while ( std::next_permutation(order.begin(), order.end()) );
+
+  return best;
+}
+
+/** A degenerate ring sitting at the centroid of @c s, for pieces that could not be cut */
+VectorShape collapsed(const VectorShape &s)
+{
+  const Point c = s.centroid();
+  return VectorShape { c, c, c };
+}
+
+}
+
+const PackedShapes &MultiInterpolator::at(float dt)
+{
+  if ( mMorph )
+    mMorph->at(dt, mCur.points.begin());
+  return mCur;
+}
+
+void MultiInterpolator::setMorphs(const std::vector<std::shared_ptr<const PreparedMorph>> &morphs)
+{
+  mMorph = std::make_shared<const PreparedMorph>(morphs);
+
+  mCur = PackedShapes();
+  mCur.points.resize(mMorph->size());
+  for (const auto &m: morphs)
+    mCur.offsets.push_back(mCur.offsets.back() + m->size());
+}
+
+std::vector<VectorShape> MultiInterpolator::cutLike(const VectorShape &whole, const std::vector<VectorShape> &parts,
+                                                    float maxSegmentLength)
+{
+  if ( parts.empty() )
+    return {};
+
+  // the shape needs enough points to get one triangle per piece
+  VectorShape ring = whole;
+  ring.normalize(maxSegmentLength);
+  if ( ring.size() < parts.size()+2 )
+    ring.addPoints(parts.size()+2 - ring.size());
+
+  std::vector<VectorShape> pieces = cut(ring, parts.size());
+  while ( pieces.size() < parts.size() )
+    pieces.push_back(collapsed(ring));
+
+  const auto order = pieceOrder(pieces, parts);
+  std::vector<VectorShape> res;
+  res.reserve(parts.size());
+  for (const auto i: order)
+    res.push_back(std::move(pieces[i]));
+  return res;
+}
+
+SeparateInterpolator::SeparateInterpolator(const VectorShape &from, const std::vector<VectorShape> &to, float maxSegmentLength)
+{
+  const auto pieces = cutLike(from, to, maxSegmentLength);
+
+  std::vector<std::shared_ptr<const PreparedMorph>> morphs;
+  for (size_t i=0; i<pieces.size(); i++) {
+    morphs.push_back(SingleInterpolator(pieces[i], to[i], maxSegmentLength).prepared());
+  }
+  setMorphs(morphs);
+}
+
+CombineInterpolator::CombineInterpolator(const std::vector<VectorShape> &from, const VectorShape &to, float maxSegmentLength)
+{
+  const auto pieces = cutLike(to, from, maxSegmentLength);
+
+  std::vector<std::shared_ptr<const PreparedMorph>> morphs;
+  for (size_t i=0; i<pieces.size(); i++) {
+    morphs.push_back(SingleInterpolator(from[i], pieces[i], maxSegmentLength).prepared());
+  }
+  setMorphs(morphs);
+}
+
+AllInterpolator::AllInterpolator(const std::vector<VectorShape> &from, const std::vector<VectorShape> &to, float maxSegmentLength)
+{
+  // the smaller side is assigned to the larger one, whose shapes give the output order
+  const bool split = from.size() <= to.size();
+  const auto &few = split ? from : to;
+  const auto &many = split ? to : from;
+
+  std::vector<std::shared_ptr<const PreparedMorph>> morphs(many.size());
+  if ( few.empty() ) {
+    setMorphs({});
+    return;
+  }
+
+  std::vector<assignment::Descriptor> fewDesc, manyDesc;
+  for (const auto &s: few)
+    fewDesc.push_back(assignment::describe(s));
+  for (const auto &s: many)
+    manyDesc.push_back(assignment::describe(s));
+
+  // groups[i]: shapes of the larger side turned from/into shape i of the smaller side
+  std::vector<std::vector<unsigned>> groups(few.size());
+  std::vector<bool> assigned(many.size(), false);
+  const auto match = assignment::solve(fewDesc, manyDesc);
+  for (unsigned i=0; i<few.size(); i++) {
+    groups[i].push_back(match[i]);
+    assigned[match[i]] = true;
+  }
+  for (unsigned j=0; j<many.size(); j++) {
+    if ( assigned[j] )
+      continue;
+    unsigned nearest = 0;
+    for (unsigned i=1; i<few.size(); i++) {
+      if ( assignment::cost(fewDesc[i], manyDesc[j]) < assignment::cost(fewDesc[nearest], manyDesc[j]) )
+        nearest = i;
+    }
+    groups[nearest].push_back(j);
+  }
+
+  for (unsigned i=0; i<few.size(); i++) {
+    std::vector<VectorShape> parts;
+    for (const auto j: groups[i])
+      parts.push_back(many[j]);
+    const auto pieces = groups[i].size() > 1 ? cutLike(few[i], parts, maxSegmentLength)
+                                             : std::vector<VectorShape> { few[i] };
+
+    for (size_t k=0; k<parts.size(); k++) {
+      morphs[groups[i][k]] = split ? SingleInterpolator(pieces[k], parts[k], maxSegmentLength).prepared()
+                                   : SingleInterpolator(parts[k], pieces[k], maxSegmentLength).prepared();
+    }
+  }
+
+  setMorphs(morphs);
+}
+
+}
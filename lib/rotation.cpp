@@ -0,0 +1,525 @@
+#include "rotation.h"
+#include "flubberpp.h"
+
+#include <complex>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <thread>
+#include <memory_resource>
+
+#if defined(__AVX__) || defined(__SSE2__)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Note: this file is built with floating point contraction disabled (see CMakeLists.txt)
+// so that the scalar and vector paths perform exactly the same roundings.
+
+namespace flubberpp {
+namespace rotation {
+
+namespace {
+
+using Complex = std::complex<double>;
+
+/** In place iterative radix-2 FFT. @c data size must be a power of two */
+void transform(std::pmr::vector<Complex> &data, bool inverse)
+{
+  const size_t n = data.size();
+
+  // bit reversal permutation
+  for (size_t i=1, j=0; i<n; i++) {
+    size_t bit = n >> 1;
+    for (; j & bit; bit >>= 1)
+      j ^= bit;
+    j ^= bit;
+    if ( i < j )
+      std::swap(data[i], data[j]);
+  }
+
+  constexpr double pi = 3.14159265358979323846;
+  for (size_t len=2; len<=n; len<<=1) {
+    const double angle = 2*pi/len * (inverse ? 1 : -1);
+    const Complex wlen(std::cos(angle), std::sin(angle));
+    for (size_t i=0; i<n; i+=len) {
+      Complex w(1);
+      for (size_t j=0; j<len/2; j++) {
+        const Complex u = data[i+j];
+        const Complex v = data[i+j+len/2]*w;
+        data[i+j] = u+v;
+        data[i+j+len/2] = u-v;
+        w *= wlen;
+      }
+    }
+  }
+
+  if ( inverse ) {
+    for (auto &c: data)
+      c /= double(n);
+  }
+}
+
+// Each lane of a vector handles its own offset, so that the terms of an offset are summed
+// in the same order whatever the vector width is.
+#if defined(__AVX__)
+struct Lanes {
+  using Reg = __m256;
+  static constexpr unsigned size = 8;
+  static Reg load(const float *p) { return _mm256_loadu_ps(p); }
+  static Reg set1(float v) { return _mm256_set1_ps(v); }
+  static Reg zero() { return _mm256_setzero_ps(); }
+  static Reg sub(Reg a, Reg b) { return _mm256_sub_ps(a, b); }
+  static Reg add(Reg a, Reg b) { return _mm256_add_ps(a, b); }
+  static Reg mul(Reg a, Reg b) { return _mm256_mul_ps(a, b); }
+  static bool greater(Reg a, Reg b) { return _mm256_movemask_ps(_mm256_cmp_ps(a, b, _CMP_GT_OQ)) == 0xff; }
+  static void store(float *p, Reg a) { _mm256_storeu_ps(p, a); }
+};
+#elif defined(__SSE2__)
+struct Lanes {
+  using Reg = __m128;
+  static constexpr unsigned size = 4;
+  static Reg load(const float *p) { return _mm_loadu_ps(p); }
+  static Reg set1(float v) { return _mm_set1_ps(v); }
+  static Reg zero() { return _mm_setzero_ps(); }
+  static Reg sub(Reg a, Reg b) { return _mm_sub_ps(a, b); }
+  static Reg add(Reg a, Reg b) { return _mm_add_ps(a, b); }
+  static Reg mul(Reg a, Reg b) { return _mm_mul_ps(a, b); }
+  static bool greater(Reg a, Reg b) { return _mm_movemask_ps(_mm_cmpgt_ps(a, b)) == 0xf; }
+  static void store(float *p, Reg a) { _mm_storeu_ps(p, a); }
+};
+#elif defined(__ARM_NEON)
+struct Lanes {
+  using Reg = float32x4_t;
+  static constexpr unsigned size = 4;
+  static Reg load(const float *p) { return vld1q_f32(p); }
+  static Reg set1(float v) { return vdupq_n_f32(v); }
+  static Reg zero() { return vdupq_n_f32(0.f); }
+  static Reg sub(Reg a, Reg b) { return vsubq_f32(a, b); }
+  static Reg add(Reg a, Reg b) { return vaddq_f32(a, b); }
+  static Reg mul(Reg a, Reg b) { return vmulq_f32(a, b); }
+  static bool greater(Reg a, Reg b) {
+    const uint32x4_t c = vcgtq_f32(a, b);
+    const uint32x2_t half = vand_u32(vget_low_u32(c), vget_high_u32(c));
+    return vget_lane_u32(half, 0) & vget_lane_u32(half, 1);
+  }
+  static void store(float *p, Reg a) { vst1q_f32(p, a); }
+};
+#else
+struct Lanes {
+  using Reg = float;
+  static constexpr unsigned size = 1;
+  static Reg load(const float *p) { return *p; }
+  static Reg set1(float v) { return v; }
+  static Reg zero() { return 0.f; }
+  static Reg sub(Reg a, Reg b) { return a - b; }
+  static Reg add(Reg a, Reg b) { return a + b; }
+  static Reg mul(Reg a, Reg b) { return a * b; }
+  static bool greater(Reg a, Reg b) { return a > b; }
+  static void store(float *p, Reg a) { *p = a; }
+};
+#endif
+
+/** Number of vectors of offsets evaluated together, to hide the latency of the additions */
+constexpr unsigned Unroll = 4;
+/** Number of offsets evaluated together */
+constexpr unsigned Block = Lanes::size * Unroll;
+
+/** Contiguous x/y arrays of the 'from' points repeated twice, so that from[(k+i)%n] is
+ *  simply x[k+i], plus some padding so that a whole block can be loaded past the last offset
+ */
+struct Rings {
+  Rings(const Point *from, const Point *to, unsigned count, std::pmr::memory_resource *mr)
+    : n(count)
+    , fromX(2*n + Block, mr), fromY(2*n + Block, mr)
+    , toX(n, mr), toY(n, mr)
+  {
+    for (size_t j=0; j<fromX.size(); j++) {
+      fromX[j] = from[j%n].x;
+      fromY[j] = from[j%n].y;
+    }
+    for (size_t i=0; i<n; i++) {
+      toX[i] = to[i].x;
+      toY[i] = to[i].y;
+    }
+  }
+
+  size_t n;
+  std::pmr::vector<float> fromX, fromY, toX, toY;
+};
+
+struct Best {
+  float minDist = std::numeric_limits<float>::max();
+  unsigned offset = 0;
+};
+
+/** Evaluates the costs of offsets [begin,end[ into @c dists, @c end being at most n.
+ *  A block of offsets whose partial sums all exceed @c limit is given up: their costs are
+ *  then only known to be greater than @c limit, and receive these partial sums
+ */
+void evaluate(const Rings &r, unsigned begin, unsigned end, float *dists,
+              float limit = std::numeric_limits<float>::max())
+{
+  // checking every few terms keeps the loop tight
+  constexpr size_t Check = 32;
+  const auto bound = Lanes::set1(limit);
+  float block[Block];
+
+  for (unsigned k=begin; k<end; k+=Block) {
+    typename Lanes::Reg acc[Unroll];
+    for (unsigned u=0; u<Unroll; u++)
+      acc[u] = Lanes::zero();
+
+    const float *fx = r.fromX.data() + k;
+    const float *fy = r.fromY.data() + k;
+    for (size_t i=0; i<r.n; ) {
+      for (const size_t stop=std::min(r.n, i+Check); i<stop; i++) {
+        const auto bx = Lanes::set1(r.toX[i]);
+        const auto by = Lanes::set1(r.toY[i]);
+        for (unsigned u=0; u<Unroll; u++) {
+          const auto dx = Lanes::sub(Lanes::load(fx + i + u*Lanes::size), bx);
+          const auto dy = Lanes::sub(Lanes::load(fy + i + u*Lanes::size), by);
+          acc[u] = Lanes::add(acc[u], Lanes::add(Lanes::mul(dx, dx), Lanes::mul(dy, dy)));
+        }
+      }
+      // the terms are >= 0, so a partial sum never exceeds the full one
+      bool exceeded = true;
+      for (unsigned u=0; u<Unroll; u++)
+        exceeded = exceeded && Lanes::greater(acc[u], bound);
+      if ( exceeded )
+        break;
+    }
+
+    for (unsigned u=0; u<Unroll; u++)
+      Lanes::store(block + u*Lanes::size, acc[u]);
+
+    std::copy_n(block, std::min<unsigned>(Block, end - k), dists + k - begin);
+  }
+}
+
+/** Brute force search among offsets [begin,end[, @c begin being a multiple of Block, giving up
+ *  the blocks of offsets whose costs all exceed @c limit.
+ *  Runs on the worker threads of bruteForce(): the costs go through a stack buffer, since the
+ *  memory resource of the interpolator, e.g. a BumpArena, needs not be thread safe
+ */
+Best search(const Rings &r, unsigned begin, unsigned end, float limit)
+{
+  constexpr unsigned Chunk = 64*Block;
+  float dists[Chunk];
+
+  Best best;
+  for (unsigned first=begin; first<end; first+=Chunk) {
+    const unsigned last = std::min(end, first+Chunk);
+    evaluate(r, first, last, dists, limit);
+    for (unsigned k=first; k<last; k++) {
+      if ( dists[k-first] < best.minDist ) {
+        best.minDist = dists[k-first];
+        best.offset = k;
+      }
+    }
+  }
+
+  return best;
+}
+
+/** Lower bound of the cost of every offset, from the smallest cost @c coarseMin of the rings
+ *  decimated by @c s. For an offset k, let A be the n-vector of full resolution differences and
+ *  B the differences of the nearest coarse offset, each repeated s times: |A| >= |B| - |A-B|.
+ *  A point of B is a point of A moved by less than 2s steps along its ring, so |A-B| is at most
+ *  the norm of the largest such moves of the 'from' points, plus the exact moves of the 'to'
+ *  points, whatever the offset
+ */
+float decimationBound(const Point *from, const Point *to, unsigned n, unsigned s, float coarseMin,
+                      std::pmr::memory_resource *mr)
+{
+  const unsigned m = n / s;
+  const unsigned window = std::min(2*s-1, n/2);
+
+  // each pair of points at most window steps apart is visited once, updating both
+  std::pmr::vector<double> moved(n, 0., mr);
+  for (unsigned p=0; p<n; p++) {
+    for (unsigned d=1, q=p+1; d<=window; d++, q++) {
+      if ( q == n )
+        q = 0;
+      const double dx = double(from[q].x) - from[p].x;
+      const double dy = double(from[q].y) - from[p].y;
+      const double sq = dx*dx + dy*dy;
+      moved[p] = std::max(moved[p], sq);
+      moved[q] = std::max(moved[q], sq);
+    }
+  }
+  double fromMoves = 0.;
+  for (const double sq: moved)
+    fromMoves += sq;
+
+  double toMoves = 0.;
+  for (unsigned i=0; i<m*s; i++) {
+    const Point &sampled = to[i - i%s];
+    const double dx = double(to[i].x) - sampled.x;
+    const double dy = double(to[i].y) - sampled.y;
+    toMoves += dx*dx + dy*dy;
+  }
+
+  const double norm = std::sqrt(double(s) * std::max(0.f, coarseMin)) - std::sqrt(fromMoves) - std::sqrt(toMoves);
+  return norm > 0. ? float(norm*norm) : 0.f;
+}
+
+/** Cost of an offset accumulated in double, giving up as soon as the partial sum exceeds @c limit */
+double exactCost(const Point *from, const Point *to, unsigned n, unsigned offset, double limit)
+{
+  constexpr unsigned Chunk = 32;
+
+  double dist = 0.;
+  for (unsigned i=0; i<n; ) {
+    const unsigned end = std::min(n, i+Chunk);
+    for (; i<end; i++) {
+      const Point &a = from[(offset+i)%n];
+      const double dx = double(a.x) - to[i].x;
+      const double dy = double(a.y) - to[i].y;
+      dist += dx*dx + dy*dy;
+    }
+    if ( dist > limit )
+      break;
+  }
+  return dist;
+}
+
+}
+
+float cost(const Point *from, const Point *to, unsigned n, unsigned offset)
+{
+  float dist = 0.f;
+  for (unsigned i=0; i<n; i++) {
+    const Point &a = from[(offset+i)%n];
+    const float dx = a.x - to[i].x;
+    const float dy = a.y - to[i].y;
+    dist = dist + (dx*dx + dy*dy);
+  }
+  return dist;
+}
+
+unsigned bruteForce(const Point *from, const Point *to, unsigned n, unsigned threads, unsigned hint,
+                    std::pmr::memory_resource *mr)
+{
+  if ( n <= 1 )
+    return 0;
+
+  const Rings r(from, to, n, mr);
+  // the cost of any offset bounds the best one. cost() sums like evaluate(), so the hint
+  // itself is never given up
+  const float limit = cost(from, to, n, hint % n);
+
+  // split the offsets in whole blocks, and don't bother starting threads for a few blocks
+  const unsigned blocks = (n + Block - 1) / Block;
+  threads = std::max(1u, std::min(threads, blocks / 4));
+  if ( threads == 1 )
+    return search(r, 0, n, limit).offset;
+
+  std::pmr::vector<Best> results(threads, mr);
+  std::vector<std::thread> workers;
+  workers.reserve(threads-1);
+  for (unsigned t=0; t<threads; t++) {
+    const unsigned begin = std::min(n, blocks*t/threads * Block);
+    const unsigned end = std::min(n, blocks*(t+1)/threads * Block);
+    if ( t == threads-1 )
+      results[t] = search(r, begin, end, limit);
+    else
+      workers.emplace_back([&r,&results,t,begin,end,limit]() { results[t] = search(r, begin, end, limit); });
+  }
+  for (auto &w: workers)
+    w.join();
+
+  // chunks are ordered by offsets: a strict comparison keeps the smallest offset on ties
+  Best best;
+  for (const auto &res: results) {
+    if ( res.minDist < best.minDist )
+      best = res;
+  }
+  return best.offset;
+}
+
+unsigned fft(const Point *from, const Point *to, unsigned n, std::pmr::memory_resource *mr)
+{
+  if ( n <= 1 )
+    return 0;
+
+  // points are seen as complex numbers z = x+iy, so that Re(a*conj(b)) is the dot product a.b.
+  // 'from' is repeated twice so that the linear correlation with 'to' gives the circular one
+  // for the first n offsets. The padding to m >= 2n prevents any wrap around.
+  size_t m = 1;
+  while ( m < 2*n )
+    m <<= 1;
+
+  std::pmr::vector<Complex> a(m, mr), b(m, mr);
+  double fromSq = 0., toSq = 0.;
+  for (size_t i=0; i<n; i++) {
+    a[i] = a[i+n] = Complex(from[i].x, from[i].y);
+    b[i] = Complex(to[i].x, to[i].y);
+    fromSq += std::norm(a[i]);
+    toSq += std::norm(b[i]);
+  }
+
+  transform(a, false);
+  transform(b, false);
+  for (size_t i=0; i<m; i++)
+    a[i] *= std::conj(b[i]);
+  transform(a, true);
+
+  // cost(k) = sum|from|² + sum|to|² - 2 sum_i from[(k+i)%n].to[i]
+  std::pmr::vector<double> costs(n, mr);
+  double minCost = std::numeric_limits<double>::max();
+  for (size_t k=0; k<n; k++) {
+    costs[k] = fromSq + toSq - 2*a[k].real();
+    minCost = std::min(minCost, costs[k]);
+  }
+
+  // The FFT error is driven by the magnitude of the summed terms, and so is the error of the
+  // double re-evaluations. Only the offsets whose FFT cost is within both errors of the minimum
+  // can be the best one
+  const double sq = fromSq + toSq;
+  const double error = 1e-12 * std::log2(double(m)) * sq + 2. * n * std::numeric_limits<double>::epsilon() * sq;
+  std::pmr::vector<unsigned> candidates(mr);
+  for (unsigned offset=0; offset<n; offset++) {
+    if ( costs[offset] <= minCost + 2*error )
+      candidates.push_back(offset);
+  }
+  std::sort(candidates.begin(), candidates.end(), [&costs](unsigned a, unsigned b) {
+    return costs[a] < costs[b] || (costs[a] == costs[b] && a < b);
+  });
+
+  // exact costs in increasing FFT cost order, until the FFT tells the next ones are worse.
+  // Rings symmetric under many rotations, e.g. a constant 'to', tie everywhere: past a few
+  // checks the remaining offsets are within the FFT error of the best one, and left out
+  constexpr size_t MaxChecks = 32;
+  unsigned bestOffset = 0;
+  double best = std::numeric_limits<double>::max();
+  for (size_t k=0; k<std::min(MaxChecks, candidates.size()); k++) {
+    const unsigned offset = candidates[k];
+    if ( costs[offset] - error > best )
+      break;
+
+    const double dist = exactCost(from, to, n, offset, best);
+    if ( dist < best || (dist == best && offset < bestOffset) ) {
+      best = dist;
+      bestOffset = offset;
+    }
+  }
+
+  return bestOffset;
+}
+
+unsigned approximate(const Point *from, const Point *to, unsigned n,
+                     unsigned decimation, unsigned candidates, float *bound, unsigned hint,
+                     std::pmr::memory_resource *mr)
+{
+  if ( n <= 1 ) {
+    if ( bound )
+      *bound = n ? cost(from, to, n, 0) : 0.f;
+    return 0;
+  }
+
+  candidates = std::max(1u, candidates);
+  if ( !decimation ) {
+    // coarse pass costs (n/s)², fine pass 2*candidates*s*n: balanced for s³ = n/candidates
+    decimation = std::lround(std::cbrt(double(n)/candidates));
+  }
+  const unsigned s = std::max(1u, std::min(decimation, n/2));
+  const unsigned m = n / s;
+
+  // coarse pass: costs of offsets multiple of s on the decimated rings
+  std::pmr::vector<Point> coarseFrom(m, mr), coarseTo(m, mr);
+  for (unsigned j=0; j<m; j++) {
+    coarseFrom[j] = from[j*s];
+    coarseTo[j] = to[j*s];
+  }
+  std::pmr::vector<float> coarse(m, mr);
+  evaluate(Rings(coarseFrom.data(), coarseTo.data(), m, mr), 0, m, coarse.data());
+
+  std::pmr::vector<unsigned> order(m, mr);
+  for (unsigned j=0; j<m; j++)
+    order[j] = j;
+  const unsigned kept = std::min(candidates, m);
+  std::partial_sort(order.begin(), order.begin()+kept, order.end(), [&coarse](unsigned a, unsigned b) {
+    return coarse[a] < coarse[b] || (coarse[a] == coarse[b] && a < b);
+  });
+
+  if ( bound ) {
+    *bound = std::max(lowerBound(from, to, n), decimationBound(from, to, n, s,
+                      coarse[order[0]] * (1.f - 2.f*m*std::numeric_limits<float>::epsilon()), mr));
+  }
+
+  // fine pass: full resolution around the best coarse offsets and the hint. The windows are
+  // merged into runs of consecutive offsets, evaluated by blocks like bruteForce(), and given
+  // up beyond the cost of the hint
+  std::pmr::vector<bool> window(n, false, mr);
+  for (unsigned c=0; c<=kept; c++) {
+    const unsigned center = c < kept ? order[c]*s : hint % n;
+    for (unsigned d=0; d<2*s+1; d++)
+      window[(center + n - s + d) % n] = true;
+  }
+
+  const Rings rings(from, to, n, mr);
+  const float limit = cost(from, to, n, hint % n);
+  std::pmr::vector<float> dists(n, mr);
+  Best best;
+  for (unsigned begin=0; begin<n; ) {
+    if ( !window[begin] ) {
+      begin++;
+      continue;
+    }
+    unsigned end = begin;
+    while ( end < n && window[end] )
+      end++;
+    evaluate(rings, begin, end, dists.data() + begin, limit);
+    for (unsigned k=begin; k<end; k++) {
+      if ( dists[k] < best.minDist ) {
+        best.minDist = dists[k];
+        best.offset = k;
+      }
+    }
+    begin = end;
+  }
+
+  return best.offset;
+}
+
+unsigned find(RotationMethod method, const Point *from, const Point *to, unsigned n,
+              unsigned threads, unsigned decimation, unsigned candidates, float *bound, unsigned hint,
+              std::pmr::memory_resource *mr)
+{
+  switch ( method ) {
+    case RotationMethod::BruteForce:
+      return bruteForce(from, to, n, threads, hint, mr);
+    case RotationMethod::Fft:
+      return fft(from, to, n, mr);
+    case RotationMethod::Approximate:
+      return approximate(from, to, n, decimation, candidates, bound, hint, mr);
+  }
+  return 0;
+}
+
+float lowerBound(const Point *from, const Point *to, unsigned n)
+{
+  if ( !n )
+    return 0.f;
+
+  double fx = 0., fy = 0., tx = 0., ty = 0.;
+  for (size_t i=0; i<n; i++) {
+    fx += from[i].x; fy += from[i].y;
+    tx += to[i].x; ty += to[i].y;
+  }
+  fx /= n; fy /= n; tx /= n; ty /= n;
+
+  double fromSq = 0., toSq = 0.;
+  for (size_t i=0; i<n; i++) {
+    fromSq += (from[i].x-fx)*(from[i].x-fx) + (from[i].y-fy)*(from[i].y-fy);
+    toSq += (to[i].x-tx)*(to[i].x-tx) + (to[i].y-ty)*(to[i].y-ty);
+  }
+
+  const double spread = std::sqrt(fromSq) - std::sqrt(toSq);
+  return n*((fx-tx)*(fx-tx) + (fy-ty)*(fy-ty)) + spread*spread;
+}
+
+}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include "shape.h"
+
+#include <memory_resource>
+
+namespace flubberpp {
+
+enum class RotationMethod;
+
+/** Best start offset searches used by SingleInterpolator::rotate.
+ *  All functions take the n points of the 'from' and 'to' shapes, and return the offset k
+ *  minimizing sum_i |from[(k+i)%n] - to[i]|^2. On ties, the smallest offset wins.
+ *  Temporary buffers are allocated from @c mr
+ */
+namespace rotation {
+
+/** Sum of square distances between the 'from' shape started at @c offset and the 'to' shape.
+ *  The terms are accumulated in order, this is the reference every search agrees with
+ */
+float cost(const Point *from, const Point *to, unsigned n, unsigned offset);
+
+/** Tries every offset, O(N²). The offsets are spread over @c threads workers and
+ *  evaluated several at once with SSE/AVX/NEON when available. Each offset still
+ *  accumulates its terms in the same order as cost(), so the result does not depend on the
+ *  instruction set nor on the number of threads.
+ *  The cost of offset @c hint, e.g. the best offset of a previous search on similar shapes,
+ *  bounds the best cost: offsets are given up as soon as their partial sums exceed it. The
+ *  result does not depend on the hint, only the time taken
+ */
+unsigned bruteForce(const Point *from, const Point *to, unsigned n, unsigned threads = 1, unsigned hint = 0,
+                    std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+/** Expands the sum of square distances into constant terms and a cyclic dot product
+ *  that is computed for all the offsets at once with a circular cross-correlation through
+ *  FFT, O(N log N). The few offsets whose FFT cost is within its error of the minimum are
+ *  re-evaluated in double, by increasing FFT cost and with early abandon, until the next FFT
+ *  cost minus its error exceeds the best exact cost, or after 32 of them.
+ *  The result is the offset of minimal exact cost, unless more than 32 offsets tie within the
+ *  FFT error, e.g. for rings symmetric under many rotations: it is then within that error of
+ *  the minimum. bruteForce() sums in float, and may pick a neighbouring offset whose cost
+ *  differs by less than its float rounding
+ */
+unsigned fft(const Point *from, const Point *to, unsigned n,
+             std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+/** Coarse to fine search. Offsets are first searched on copies of both shapes keeping one
+ *  point every @c decimation points. The full resolution cost is then evaluated only around
+ *  the @c candidates best coarse offsets and around @c hint, by blocks of consecutive offsets
+ *  given up beyond the cost of the hint, like bruteForce(). The result is never worse than the
+ *  hint. A @c decimation of 0 picks the factor that balances the coarse and the fine passes.
+ *  The result is not guaranteed to be optimal. If @c bound is given, it receives a lower bound
+ *  of the best cost: the smallest coarse cost scaled to the full ring, minus how far decimating
+ *  moves the points, or lowerBound() if larger. Computing it about doubles the search time
+ */
+unsigned approximate(const Point *from, const Point *to, unsigned n,
+                     unsigned decimation = 0, unsigned candidates = 4, float *bound = nullptr, unsigned hint = 0,
+                     std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+/** Runs the search selected by @c method, with the settings it takes: the @c threads of
+ *  bruteForce(), the @c decimation, @c candidates and @c bound of approximate(), and the
+ *  @c hint of both. @c bound is left alone by the exact methods, fft() takes no hint
+ */
+unsigned find(RotationMethod method, const Point *from, const Point *to, unsigned n,
+              unsigned threads = 1, unsigned decimation = 0, unsigned candidates = 4, float *bound = nullptr,
+              unsigned hint = 0, std::pmr::memory_resource *mr = std::pmr::get_default_resource());
+
+/** A lower bound of the cost of the best offset, computed in O(N).
+ *  Rotating doesn't move the centroids, and the centered dot product is bounded by the
+ *  product of the centered norms (Cauchy-Schwarz), hence
+ *  cost >= n*|cfrom-cto|² + (|from-cfrom| - |to-cto|)²
+ */
+float lowerBound(const Point *from, const Point *to, unsigned n);
+
+}
+
+}
@@ -0,0 +1,141 @@
+#include "serialize.h"
+#include "mappedfile.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+
+namespace flubberpp {
+
+namespace {
+
+constexpr char Magic[8] = { 'F','L','B','P','M','R','P','H' };
+constexpr std::size_t HeaderSize = 16;
+constexpr std::size_t EntrySize = 16;
+constexpr std::size_t Alignment = 32;
+
+bool littleEndian()
+{
+  const std::uint32_t one = 1;
+  unsigned char first;
+  std::memcpy(&first, &one, 1);
+  return first == 1;
+}
+
+std::size_t aligned(std::size_t offset)
+{
+  return (offset + Alignment - 1) / Alignment * Alignment;
+}
+
+/** Bytes of an array of n floats, padded so that the next one is aligned */
+std::size_t arrayBytes(std::size_t n)
+{
+  return aligned(n * sizeof(float));
+}
+
+void putLE(unsigned char *out, std::uint64_t v, unsigned bytes)
+{
+  for (unsigned i=0; i<bytes; i++)
+    out[i] = static_cast<unsigned char>(v >> (8*i));
+}
+
+std::uint64_t getLE(const unsigned char *in, unsigned bytes)
+{
+  std::uint64_t v = 0;
+  for (unsigned i=0; i<bytes; i++)
+    v |= std::uint64_t(in[i]) << (8*i);
+  return v;
+}
+
+void putArray(std::ostream &out, const float *a, std::size_t n)
+{
+  std::vector<unsigned char> buf(arrayBytes(n), 0);
+  for (std::size_t i=0; i<n; i++) {
+    std::uint32_t bits;
+    std::memcpy(&bits, a+i, 4);
+    putLE(buf.data() + 4*i, bits, 4);
+  }
+  out.write(reinterpret_cast<const char*>(buf.data()), buf.size());
+}
+
+}
+
+bool saveMorphs(const std::string &path, const std::vector<std::shared_ptr<const PreparedMorph>> &morphs)
+{
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if ( !out )
+    return false;
+
+  std::vector<unsigned char> head(aligned(HeaderSize + EntrySize*morphs.size()), 0);
+  std::memcpy(head.data(), Magic, sizeof(Magic));
+  putLE(head.data() + 8, MorphFileVersion, 4);
+  putLE(head.data() + 12, morphs.size(), 4);
+  std::size_t offset = head.size();
+  for (std::size_t i=0; i<morphs.size(); i++) {
+    putLE(head.data() + HeaderSize + EntrySize*i, offset, 8);
+    putLE(head.data() + HeaderSize + EntrySize*i + 8, morphs[i]->size(), 8);
+    offset += 4*arrayBytes(morphs[i]->size());
+  }
+  out.write(reinterpret_cast<const char*>(head.data()), head.size());
+
+  for (const auto &m: morphs) {
+    putArray(out, m->from().x, m->size());
+    putArray(out, m->from().y, m->size());
+    putArray(out, m->delta().x, m->size());
+    putArray(out, m->delta().y, m->size());
+  }
+
+  return bool(out.flush());
+}
+
+bool loadMorphs(const std::string &path, std::vector<std::shared_ptr<const PreparedMorph>> &morphs)
+{
+  // the file can be used in place only if its floats are in our byte order
+  const bool inPlace = littleEndian();
+  auto file = std::make_shared<MappedFile>();
+  if ( !file->open(path, inPlace) )
+    return false;
+
+  const unsigned char *data = file->data();
+  const std::size_t size = file->size();
+  if ( size < HeaderSize || std::memcmp(data, Magic, sizeof(Magic)) != 0
+       || getLE(data + 8, 4) != MorphFileVersion )
+    return false;
+
+  const std::size_t count = getLE(data + 12, 4);
+  if ( (size - HeaderSize) / EntrySize < count )
+    return false;
+
+  std::vector<std::shared_ptr<const PreparedMorph>> result;
+  result.reserve(count);
+  for (std::size_t i=0; i<count; i++) {
+    const std::uint64_t offset = getLE(data + HeaderSize + EntrySize*i, 8);
+    const std::uint64_t n = getLE(data + HeaderSize + EntrySize*i + 8, 8);
+    if ( offset % Alignment != 0 || offset > size || n > (size - offset) / 16
+         || 4*arrayBytes(n) > size - offset )
+      return false;
+
+    const unsigned char *arrays = data + offset;
+    const std::size_t stride = arrayBytes(n);
+    if ( inPlace ) {
+      const float *a = reinterpret_cast<const float*>(arrays);
+      const std::size_t s = stride / sizeof(float);
+      result.push_back(std::make_shared<PreparedMorph>(XYSpan { a, a + s, n }, XYSpan { a + 2*s, a + 3*s, n }, file));
+    } else {
+      // byte swapped copy, in the layout of the file
+      auto copy = std::make_shared<AlignedFloats>(4*stride / sizeof(float));
+      for (std::size_t k=0; k<copy->size(); k++) {
+        const std::uint32_t bits = getLE(arrays + 4*k, 4);
+        std::memcpy(copy->data() + k, &bits, 4);
+      }
+      const float *a = copy->data();
+      const std::size_t s = stride / sizeof(float);
+      result.push_back(std::make_shared<PreparedMorph>(XYSpan { a, a + s, n }, XYSpan { a + 2*s, a + 3*s, n }, std::move(copy)));
+    }
+  }
+
+  morphs = std::move(result);
+  return true;
+}
+
+};
@@ -0,0 +1,39 @@
+#pragma once
+
+#ifdef FLUBBERPP_LIBRARY
+#if _WIN32
+#define FLUBBERPP_EXPORT __declspec(dllexport)
+#else
+#define FLUBBERPP_EXPORT __attribute__((visibility("default")))
+#endif
+#else
+#define FLUBBERPP_EXPORT
+#endif
+
+#include "morph.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace flubberpp {
+
+/** Binary file format of prepared morphs, so that they can be saved once and loaded instantly.
+ *  All values are little endian:
+ *  - header: magic "FLBPMRPH", u32 version, u32 number of morphs
+ *  - table: per morph, u64 offset of its data from the start of the file and u64 number of points
+ *  - data: per morph, the arrays from x, from y, delta x, delta y of float32, each one starting
+ *    on a 32 bytes boundary
+ */
+constexpr unsigned MorphFileVersion = 1;
+
+/** Writes @c morphs to file @c path. Returns false on I/O error */
+FLUBBERPP_EXPORT bool saveMorphs(const std::string &path, const std::vector<std::shared_ptr<const PreparedMorph>> &morphs);
+
+/** Reads the morphs of file @c path into @c morphs. The file is memory mapped when possible and
+ *  the morphs are evaluated directly from the mapped pages, which stay mapped as long as one of
+ *  the morphs exists. Returns false if the file can't be read or is not a valid morph file
+ */
+FLUBBERPP_EXPORT bool loadMorphs(const std::string &path, std::vector<std::shared_ptr<const PreparedMorph>> &morphs);
+
+};
@@ -17,70 +17,108 @@
 
 #include <list>
 #include <vector>
+#include <algorithm>
 #include <set>
+#include <memory_resource>
 #include <cmath>
+#include <tuple>
 #include <type_traits>
+#include <limits>
+
+#include "simplify.h"
 
 namespace flubberpp {
 
-/** A 2D point */
-struct FLUBBERPP_EXPORT Point {
-    float x,y;
+/** A 2D point with coordinates of type T */
+template <typename T>
+struct FLUBBERPP_EXPORT BasicPoint {
+    T x,y;
 
     /** Distance to another point */
-    float distance(const Point &other) const { return std::sqrt((other.x-x)*(other.x-x) + (other.y-y)*(other.y-y)); }
+    T distance(const BasicPoint &other) const { return std::sqrt((other.x-x)*(other.x-x) + (other.y-y)*(other.y-y)); }
     /** Point between this and another point, from 0 to 1 */
-    Point pointAlong(const Point &b, float dt) const {
-      return Point {
+    BasicPoint pointAlong(const BasicPoint &b, T dt) const {
+      return BasicPoint {
         x + (b.x-x)*dt,
         y + (b.y-y)*dt
       };
     }
     /** Nearly same point */
-    bool operator ==(const Point &other) const { return this->distance(other) < 1e-4f; }
+    bool operator ==(const BasicPoint &other) const { return this->distance(other) < T(1e-4); }
     /** Compare  points */
-    bool operator < (const Point& other) const { return std::tie(x, y) < std::tie(other.x, other.y); }
+    bool operator < (const BasicPoint& other) const { return std::tie(x, y) < std::tie(other.x, other.y); }
 };
 
-inline Point operator+(const Point &a, const Point &b) { return Point{a.x+b.x,a.y+b.y}; }
-inline Point operator-(const Point &a, const Point &b) { return Point{a.x-b.x,a.y-b.y}; }
+template <typename T>
+inline BasicPoint<T> operator+(const BasicPoint<T> &a, const BasicPoint<T> &b) { return BasicPoint<T>{a.x+b.x,a.y+b.y}; }
+template <typename T>
+inline BasicPoint<T> operator-(const BasicPoint<T> &a, const BasicPoint<T> &b) { return BasicPoint<T>{a.x-b.x,a.y-b.y}; }
 
-/** A shape that store its points using the provided template container.
+/** A 2D point, the type the interpolations are evaluated with */
+using Point = BasicPoint<float>;
+/** A 2D point with double precision, e.g. for projected geographic coordinates */
+using PointD = BasicPoint<double>;
+
+/** A shape that store its points using the provided template container and allocator.
  *  (e.g. Shape<std::vector> will store the points as a vector
+ *  The point type is the one of the allocator, Point by default
  */
-template< template<typename,typename> class Container >
-struct FLUBBERPP_EXPORT Shape : Container<Point, std::allocator<Point>> {
-    using ContainerType = Container<Point, std::allocator<Point>>;
+template< template<typename,typename> class Container, typename Alloc = std::allocator<Point> >
+struct FLUBBERPP_EXPORT Shape : Container<typename Alloc::value_type, Alloc> {
+    using PointType = typename Alloc::value_type;
+    using Scalar = decltype(PointType::x);
+    using ContainerType = Container<PointType, Alloc>;
     using IteratorCategory = typename std::iterator_traits<typename ContainerType::iterator>::iterator_category;
     using random = std::is_same<
       IteratorCategory,
       std::random_access_iterator_tag>;
 
     // same ctors
-    using Container<Point, std::allocator<Point>>::Container;
+    using ContainerType::Container;
 
     /** Shape area */
-    float area() const {
+    Scalar area() const {
       if ( this->size() <= 2 )
-        return 0.f;
+        return Scalar(0);
 
-      float area = 0.f;
-      Point a;
-      Point b = *(--this->cend());
+      Scalar area = Scalar(0);
+      PointType a;
+      PointType b = *(--this->cend());
 
       for (auto it=this->cbegin(); it!=this->cend(); ++it) {
         a = b;
         b = *it;
         area += a.y*b.x - a.x*b.y;
       }
-      return area / 2.f;
+      return area / Scalar(2);
+    }
+    /** Shape centroid, weighted by area, or the mean of its points when it is flat */
+    PointType centroid() const {
+      double x = 0., y = 0., area = 0., mx = 0., my = 0.;
+      if ( this->empty() )
+        return PointType { Scalar(0), Scalar(0) };
+
+      PointType b = *(--this->cend());
+      for (auto it=this->cbegin(); it!=this->cend(); ++it) {
+        const PointType a = b;
+        b = *it;
+        const double cross = double(a.x)*b.y - double(b.x)*a.y;
+        x += (a.x+b.x)*cross;
+        y += (a.y+b.y)*cross;
+        area += cross;
+        mx += b.x;
+        my += b.y;
+      }
+      if ( std::abs(area) < 1e-9 )
+        return PointType { Scalar(mx/this->size()), Scalar(my/this->size()) };
+      return PointType { Scalar(x/(3*area)), Scalar(y/(3*area)) };
     }
     /** Shape perimeter */
-    float length() const {
+    Scalar length() const {
       if ( this->size() <= 1 )
-        return 0.f;
+        return Scalar(0);
 
-      float peri = 0.f;
+      Scalar peri = Scalar(0);
 
       auto it = this->cbegin();
       for (auto i=0; i<this->size()-1; i++) {
@@ -90,24 +128,73 @@ struct FLUBBERPP_EXPORT Shape : Container<Point, std::allocator<Point>> {
       peri += (--this->cend())->distance(*this->cbegin());
       return peri;
     }
-    /** Add nb points to the shape, uniformly distributed among its length
-     *  Only available for non random access containers
+    /** Add nb points to the shape, uniformly distributed among its length, but no more than
+     *  needed to reach @c maxPoints points (0 = no limit)
+     *  Random access containers are rebuilt in a single pass into a buffer of the final
+     *  size, with the very same points as the in place insertions of node based containers
      */
-    void addPoints(unsigned nb) {
-      static_assert(!random::value, "Random access containers are not supported by this method");
+    void addPoints(unsigned nb, size_t maxPoints = 0) {
+      if ( maxPoints )
+        nb = unsigned(std::min<size_t>(nb, this->size() < maxPoints ? maxPoints - this->size() : 0));
+
+      if constexpr(random::value) {
+        const auto n = this->size();
+        if ( !nb || !n )
+          return;
+
+        const auto step = this->length() / nb;
+
+        Scalar cursor = Scalar(0);
+        Scalar insertAt = step / Scalar(2);
+
+        ContainerType out(this->get_allocator());
+        out.reserve(n + nb);
+
+        // replays the list insertions: 'a' is the current point, 'pending' holds the points
+        // inserted after it but not visited yet (next one on top), 'next' the next original point
+        const auto &p = *this;
+        ContainerType pending(this->get_allocator());
+        PointType a = p[0];
+        size_t next = 1;
+        out.push_back(a);
+
+        for (unsigned inserted=0; inserted<nb; ) {
+          const PointType b = !pending.empty() ? pending.back() : next < n ? p[next] : p[0];
+          const Scalar segment = a.distance(b);
+          if ( insertAt <= cursor+segment ) {
+            pending.push_back(segment ? a.pointAlong(b, (insertAt-cursor)/segment) : p[0]);
+            insertAt += step;
+            inserted++;
+            continue;
+          }
+
+          cursor += segment;
+          if ( !pending.empty() ) {
+            a = pending.back();
+            pending.pop_back();
+          } else if ( next < n ) {
+            a = p[next++];
+          } else {
+            break;
+          }
+          out.push_back(a);
+        }
 
-      if constexpr(!random::value) {
+        out.insert(out.end(), pending.crbegin(), pending.crend());
+        out.insert(out.end(), p.cbegin() + next, p.cend());
+        this->swap(out);
+      } else {
         const auto target = this->size() + nb;
         const auto step = this->length() / nb;
 
-        float cursor = 0.f;
-        float insertAt = step / 2.f;
+        Scalar cursor = Scalar(0);
+        Scalar insertAt = step / Scalar(2);
 
         auto it = this->cbegin();
         while (this->size() < target ) {
-          const Point &a = *it;
-          const Point &b = it == --this->cend() ? *this->cbegin() : *std::next(it);
-          const float segment = a.distance(b);
+          const PointType &a = *it;
+          const PointType &b = it == --this->cend() ? *this->cbegin() : *std::next(it);
+          const Scalar segment = a.distance(b);
           if ( insertAt <= cursor+segment ) {
             this->insert(std::next(it), segment ? a.pointAlong(b, (insertAt-cursor)/segment) : *this->cbegin());
             insertAt += step;
@@ -121,27 +208,105 @@ struct FLUBBERPP_EXPORT Shape : Container<Point, std::allocator<Point>> {
     }
     /** Make each segment of the shape at most @c seglen length by breaking
      *  long segments into smaller ones
+     *  With @c maxPoints (0 = no limit), the shape ends up with at most that many points:
+     *  when @c seglen would give more, it is raised to 2*length()/(maxPoints-size()), since
+     *  breaking a segment adds less than 2*length/seglen points. A shape that already has more
+     *  points keeps its @c maxPoints most important ones, see simplify::decimate()
+     *  Random access containers first compute the final number of points, then write the
+     *  normalized shape in a single pass, with the very same points as node based containers
      */
-    void normalize(float seglen) {
-      static_assert(!random::value, "Random access containers are not supported by this method");
+    void normalize(Scalar seglen, size_t maxPoints = 0) {
+      const auto area = this->area();
+      if ( area < 0 ) {
+        std::reverse(this->begin(), this->end());
+      }
 
-      if constexpr(!random::value) {
-        const auto area = this->area();
-        if ( area < 0 ) {
-          this->reverse();
+      if ( maxPoints && normalizedSizeBound(seglen) > maxPoints ) {
+        if ( this->size() >= maxPoints ) {
+          simplify::decimate(*this, maxPoints);
+          return;
         }
+        seglen = Scalar(2) * this->length() / Scalar(maxPoints - this->size());
+      }
+
+      if constexpr(random::value) {
+        const auto n = this->size();
+        if ( !n )
+          return;
 
+        const auto &p = *this;
+        ContainerType out(this->get_allocator());
+        out.reserve(normalizedSize(seglen));
+        for (size_t i=0; i<n; i++) {
+          out.push_back(p[i]);
+          bisect(p[i], p[(i+1)%n], seglen, [&out](const PointType &m) { out.push_back(m); });
+        }
+        this->swap(out);
+      } else {
         for (auto it=this->cbegin(); it!=this->cend(); ++it) {
-          const Point &a = *it;
-          Point b = it == --this->cend() ? *this->cbegin() : *std::next(it); // next point or loop to first
+          const PointType &a = *it;
+          PointType b = it == --this->cend() ? *this->cbegin() : *std::next(it); // next point or loop to first
 
           while ( a.distance(b) > seglen ) {
-            b = a.pointAlong(b, 0.5f);
+            b = a.pointAlong(b, Scalar(0.5));
             this->insert(std::next(it), b);
           }
         }
       }
     }
+    /** Number of points the shape would have after normalize(seglen) */
+    size_t normalizedSize(Scalar seglen) const {
+      size_t count = this->size();
+      auto it = this->cbegin();
+      for (size_t i=0; i<this->size(); i++, ++it) {
+        const PointType &b = i+1 == this->size() ? *this->cbegin() : *std::next(it);
+        bisect(*it, b, seglen, [&count](const PointType &) { count++; });
+      }
+      return count;
+    }
+
+    /** Upper bound of normalizedSize(seglen), computed in O(size()) without going through the
+     *  points: breaking a segment of length L gives the smallest power of two pieces above
+     *  L/seglen. Saturates instead of overflowing
+     */
+    size_t normalizedSizeBound(Scalar seglen) const {
+      double count = double(this->size());
+      auto it = this->cbegin();
+      for (size_t i=0; i<this->size(); i++, ++it) {
+        const PointType &b = i+1 == this->size() ? *this->cbegin() : *std::next(it);
+        // the rounding of the midpoints makes pieces up to a few ulps of the coordinates longer
+        const double slack = 4. * std::numeric_limits<Scalar>::epsilon() *
+                             std::max({ std::abs(double(it->x)), std::abs(double(it->y)), std::abs(double(b.x)), std::abs(double(b.y)) });
+        const double pieces = seglen > slack ? double(it->distance(b)) * (1. + 1e-5) / (seglen - slack)
+                                             : std::numeric_limits<double>::infinity();
+        if ( pieces > 1. )
+          count += std::exp2(std::ceil(std::log2(pieces))) - 1.;
+      }
+      return count < double(std::numeric_limits<size_t>::max()) ? size_t(count) : std::numeric_limits<size_t>::max();
+    }
+
+  private:
+    /** Emits, in order, the points that normalize() inserts between a and b.
+     *  normalize() inserts midpoints towards a right after a, then visits each of them,
+     *  breaking in turn the segments that are still too long
+     */
+    template <typename Emit>
+    static void bisect(const PointType &a, const PointType &b, Scalar seglen, Emit &&emit) {
+      // more than 64 halvings would mean more than 2^64 points
+      PointType mids[64];
+      unsigned k = 0;
+      PointType m = b;
+      while ( k < 64 && a.distance(m) > seglen ) {
+        m = a.pointAlong(m, Scalar(0.5));
+        mids[k++] = m;
+      }
+
+      // resulting order: a, mids[k-1], ..., mids[0], b
+      while ( k-- ) {
+        emit(mids[k]);
+        bisect(mids[k], k ? mids[k-1] : b, seglen, emit);
+      }
+    }
 };
 
 template <typename T>
@@ -151,8 +316,35 @@ inline bool lessArea(const T &s1, const T &s2) {
 
 /** A Shape whose underlying storage is a std::vector of points. Usually used by the user */
 using VectorShape = Shape<std::vector>;
+/** Same with double precision points */
+using VectorShapeD = Shape<std::vector, std::allocator<PointD>>;
 /** A Shape whose underlying storage is a std::list of points. Used internally to alter the shapes */
 using ListShape   = Shape<std::list>;
+/** Same shapes allocating from a std::pmr::memory_resource, e.g. a BumpArena */
+using PmrVectorShape = Shape<std::vector, std::pmr::polymorphic_allocator<Point>>;
+using PmrListShape   = Shape<std::list, std::pmr::polymorphic_allocator<Point>>;
+using PmrVectorShapeD = Shape<std::vector, std::pmr::polymorphic_allocator<PointD>>;
+
+/** Several shapes packed in a single contiguous buffer of points:
+ *  shape i is made of points [offsets[i], offsets[i+1][
+ */
+struct FLUBBERPP_EXPORT PackedShapes {
+    std::vector<Point> points;
+    std::vector<size_t> offsets { 0 };
+
+    /** Number of shapes */
+    size_t size() const { return offsets.size() - 1; }
+    /** Points of shape i */
+    const Point *begin(size_t i) const { return points.data() + offsets[i]; }
+    const Point *end(size_t i) const { return points.data() + offsets[i+1]; }
+
+    /** Appends a shape */
+    template <typename It>
+    void add(It first, It last) {
+      points.insert(points.end(), first, last);
+      offsets.push_back(points.size());
+    }
+};
 
 template <typename T> using ShapeSet = std::multiset<T, decltype(lessArea<T>)*>;
 /** A set of shapes sorted wrt their areas, vector or list */
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <vector>
+
+// included by shape.h: the functions take any point and Shape type
+namespace flubberpp {
+
+/** Vertex importance and importance driven resampling of closed rings */
+namespace simplify {
+
+/** Visvalingam-Whyatt ranking of the n vertices of a closed ring.
+ *  The vertex forming the smallest triangle with its neighbours is removed first, then the
+ *  triangles of its neighbours are updated, and so on. @c triangle(a, b, c) gives the area
+ *  of the triangle of vertices a, b and c. @c order receives the vertices in removal order and
+ *  @c area their effective areas, non decreasing along @c order.
+ *  The last 3 vertices are never removed: they come last in @c order, with an infinite area
+ */
+template <typename Triangle>
+void importance(std::size_t n, Triangle &&triangle, std::vector<double> &area, std::vector<std::size_t> &order)
+{
+  area.assign(n, std::numeric_limits<double>::infinity());
+  order.clear();
+  order.reserve(n);
+
+  std::vector<std::size_t> prev(n), next(n);
+  std::vector<double> current(n);
+  std::vector<bool> removed(n, false);
+  for (std::size_t i=0; i<n; i++) {
+    prev[i] = (i+n-1) % n;
+    next[i] = (i+1) % n;
+  }
+
+  // smallest area first, then smallest index. Entries are stale once their vertex area changed
+  using Item = std::pair<double,std::size_t>;
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>> queue;
+  if ( n > 3 ) {
+    for (std::size_t i=0; i<n; i++) {
+      current[i] = triangle(prev[i], i, next[i]);
+      queue.emplace(current[i], i);
+    }
+  }
+
+  double last = 0.;
+  for (std::size_t remaining=n; remaining>3; ) {
+    const auto [a, i] = queue.top();
+    queue.pop();
+    if ( removed[i] || a != current[i] )
+      continue;
+
+    // a vertex is at least as important as the ones removed before it
+    last = std::max(last, a);
+    area[i] = last;
+    order.push_back(i);
+    removed[i] = true;
+    remaining--;
+
+    next[prev[i]] = next[i];
+    prev[next[i]] = prev[i];
+    for (const std::size_t j: { prev[i], next[i] }) {
+      current[j] = triangle(prev[j], j, next[j]);
+      queue.emplace(current[j], j);
+    }
+  }
+  for (std::size_t i=0; i<n; i++) {
+    if ( !removed[i] )
+      order.push_back(i);
+  }
+}
+
+/** Area of the triangle abc */
+template <typename P>
+double triangleArea(const P &a, const P &b, const P &c)
+{
+  return 0.5 * std::abs((double(b.x)-a.x)*(double(c.y)-a.y) - (double(c.x)-a.x)*(double(b.y)-a.y));
+}
+
+/** Same ranking of the n points of a ring */
+template <typename P>
+void importance(const P *p, std::size_t n, std::vector<double> &area, std::vector<std::size_t> &order)
+{
+  importance(n, [p](std::size_t a, std::size_t b, std::size_t c) { return triangleArea(p[a], p[b], p[c]); }, area, order);
+}
+
+/** Keeps the @c maxPoints most important vertices of a closed ring, in ring order, at least 3 */
+template <typename S>
+void decimate(S &shape, std::size_t maxPoints)
+{
+  using P = typename S::PointType;
+
+  if ( shape.size() <= std::max<std::size_t>(3, maxPoints) )
+    return;
+
+  const std::vector<P> p(shape.cbegin(), shape.cend());
+  std::vector<double> area;
+  std::vector<std::size_t> order;
+  importance(p.data(), p.size(), area, order);
+
+  std::vector<bool> kept(p.size(), false);
+  for (std::size_t k=p.size()-std::max<std::size_t>(3, maxPoints); k<p.size(); k++)
+    kept[order[k]] = true;
+
+  std::vector<P> out;
+  out.reserve(p.size());
+  for (std::size_t i=0; i<p.size(); i++) {
+    if ( kept[i] )
+      out.push_back(p[i]);
+  }
+  shape.assign(out.cbegin(), out.cend());
+}
+
+/** Curvature aware alternative to Shape::normalize().
+ *  Vertices are dropped in importance() order while their triangle is under seglen²/50 (e.g.
+ *  nearly collinear points along a straight border), or while there are more than @c budget of
+ *  them. The remaining segments are then split like normalize() does next to corners, where
+ *  the ring turns by 45° or more, and up to 4 times less on straight runs. Splits are dropped
+ *  evenly if needed so that the ring has at most @c budget points (0 = no budget).
+ *  Orients the ring like normalize()
+ */
+template <typename S>
+void resample(S &shape, typename S::Scalar seglen, std::size_t budget = 0)
+{
+  using P = typename S::PointType;
+  using Scalar = typename S::Scalar;
+
+  if ( shape.size() < 3 ) {
+    shape.normalize(seglen, budget);
+    return;
+  }
+  if ( shape.area() < 0 )
+    std::reverse(shape.begin(), shape.end());
+
+  const std::vector<P> p(shape.cbegin(), shape.cend());
+  const std::size_t n = p.size();
+  std::vector<double> area;
+  std::vector<std::size_t> order;
+  importance(p.data(), n, area, order);
+
+  const std::size_t maxVertices = budget ? std::max<std::size_t>(3, budget) : n;
+  const double threshold = double(seglen) * seglen / 50.;
+  std::vector<bool> kept(n, true);
+  std::size_t dropped = 0;
+  while ( dropped < n && (area[order[dropped]] < threshold || n-dropped > maxVertices) )
+    kept[order[dropped++]] = false;
+
+  std::vector<P> q;
+  q.reserve(n-dropped);
+  for (std::size_t i=0; i<n; i++) {
+    if ( kept[i] )
+      q.push_back(p[i]);
+  }
+  const std::size_t m = q.size();
+
+  // how much the ring turns at each vertex, 1 from 45°
+  constexpr double pi = 3.14159265358979323846;
+  std::vector<double> turn(m);
+  for (std::size_t i=0; i<m; i++) {
+    const P &a = q[(i+m-1)%m], &b = q[i], &c = q[(i+1)%m];
+    const double ux = double(b.x)-a.x, uy = double(b.y)-a.y, vx = double(c.x)-b.x, vy = double(c.y)-b.y;
+    turn[i] = std::min(1., std::atan2(std::abs(ux*vy - uy*vx), ux*vx + uy*vy) / (pi / 4.));
+  }
+
+  // points inserted into each segment
+  std::vector<std::size_t> splits(m, 0);
+  std::size_t total = 0;
+  if ( seglen > 0 ) {
+    for (std::size_t i=0; i<m; i++) {
+      const double limit = double(seglen) * (4. - 3.*std::max(turn[i], turn[(i+1)%m]));
+      const double pieces = std::ceil(q[i].distance(q[(i+1)%m]) / limit);
+      splits[i] = pieces > 1. ? std::size_t(pieces) - 1 : 0;
+      total += splits[i];
+    }
+  }
+  if ( budget && total && m + total > budget ) {
+    const double scale = double(budget > m ? budget - m : 0) / total;
+    for (auto &s: splits)
+      s = std::size_t(s * scale);
+  }
+
+  std::vector<P> out;
+  out.reserve(m + total);
+  for (std::size_t i=0; i<m; i++) {
+    out.push_back(q[i]);
+    for (std::size_t k=1; k<=splits[i]; k++)
+      out.push_back(q[i].pointAlong(q[(i+1)%m], Scalar(k) / Scalar(splits[i]+1)));
+  }
+  shape.assign(out.cbegin(), out.cend());
+}
+
+}
+
+}
@@ -0,0 +1,23 @@
+#include "stats.h"
+
+#include <atomic>
+
+namespace flubberpp {
+
+namespace {
+
+std::atomic<SetupStatsHook> hook { nullptr };
+
+}
+
+void setSetupStatsHook(SetupStatsHook h)
+{
+  hook.store(h);
+}
+
+SetupStatsHook setupStatsHook()
+{
+  return hook.load();
+}
+
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#ifdef FLUBBERPP_LIBRARY
+#if _WIN32
+#define FLUBBERPP_EXPORT __declspec(dllexport)
+#else
+#define FLUBBERPP_EXPORT __attribute__((visibility("default")))
+#endif
+#else
+#define FLUBBERPP_EXPORT
+#endif
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+
+/** Statistics are collected only when the library is built with FLUBBERPP_ENABLE_STATS
+ *  (cmake -DFLUBBERPP_ENABLE_STATS=Yes). Otherwise FLUBBERPP_STATS() drops its arguments and
+ *  the interpolators carry no stats code nor data
+ */
+#ifdef FLUBBERPP_ENABLE_STATS
+#define FLUBBERPP_STATS(...) __VA_ARGS__
+#else
+#define FLUBBERPP_STATS(...)
+#endif
+
+namespace flubberpp {
+
+/** Statistics of a SingleInterpolator setup */
+struct FLUBBERPP_EXPORT SetupStats {
+  /** Points of the shapes as given */
+  std::size_t fromPoints = 0, toPoints = 0;
+  /** Points after normalize() */
+  std::size_t fromNormalized = 0, toNormalized = 0;
+  /** Points added by addPoints() to the smaller shape */
+  std::size_t addedPoints = 0;
+  /** Nanoseconds spent in each phase, and in the whole setup */
+  std::uint64_t normalizeNs = 0, addPointsNs = 0, rotateNs = 0, prepareNs = 0, totalNs = 0;
+  /** Chosen start offset of the 'from' shape and its sum of square distances */
+  unsigned offset = 0;
+  float minDist = 0.f;
+  /** Bytes allocated by the setup: its temporary buffers, from the memory resource of the
+   *  interpolator, and the prepared morph. The shapes, resampled and padded rings kept across
+   *  setups and the buffers of at() live on the heap and are not counted */
+  std::size_t bytesAllocated = 0;
+  /** The setup was found in the cache: no phase ran */
+  bool cached = false;
+};
+
+/** Function called with the statistics of each setup */
+using SetupStatsHook = void (*)(const SetupStats &stats);
+
+/** Calls @c hook after each setup of any interpolator, from the thread that ran it, e.g. to export
+ *  the statistics as counters and histograms. nullptr removes the hook
+ */
+FLUBBERPP_EXPORT void setSetupStatsHook(SetupStatsHook hook);
+FLUBBERPP_EXPORT SetupStatsHook setupStatsHook();
+
+/** A memory resource forwarding to another one and counting the bytes allocated through it */
+class FLUBBERPP_EXPORT CountingResource : public std::pmr::memory_resource {
+  public:
+    explicit CountingResource(std::pmr::memory_resource *upstream) : mUpstream(upstream) {}
+    /** Copies forward to the same resource and count from zero, so that the objects holding
+     *  one stay copyable */
+    CountingResource(const CountingResource &o) : std::pmr::memory_resource(o), mUpstream(o.mUpstream) {}
+    CountingResource &operator=(const CountingResource &o) {
+      mUpstream = o.mUpstream;
+      resetBytes();
+      return *this;
+    }
+
+    /** Forwards to @c upstream from now on. Memory allocated before must have been released */
+    void setUpstream(std::pmr::memory_resource *upstream) { mUpstream = upstream; }
+
+    /** Bytes allocated since the last reset */
+    std::size_t bytes() const { return mBytes.load(std::memory_order_relaxed); }
+    void resetBytes() { mBytes.store(0, std::memory_order_relaxed); }
+
+  private:
+    void *do_allocate(std::size_t bytes, std::size_t alignment) override {
+      mBytes.fetch_add(bytes, std::memory_order_relaxed);
+      return mUpstream->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, std::size_t bytes, std::size_t alignment) override {
+      mUpstream->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const noexcept override {
+      return this == &other;
+    }
+
+    std::pmr::memory_resource *mUpstream;
+    // atomic, so that counting doesn't race when the upstream resource is thread safe
+    std::atomic<std::size_t> mBytes { 0 };
+};
+
+}
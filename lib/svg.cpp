@@ -0,0 +1,348 @@
+#include "svg.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+namespace flubberpp {
+
+namespace {
+
+struct Vec {
+  double x, y;
+};
+
+/** Cursor over the path data */
+class PathParser {
+  public:
+    explicit PathParser(std::string_view d) : mCur(d.data()), mEnd(d.data() + d.size()) {}
+
+    void skipSpaces() {
+      while ( mCur < mEnd && (*mCur == ' ' || *mCur == '\t' || *mCur == '\n' || *mCur == '\r' || *mCur == '\f') )
+        mCur++;
+    }
+
+    bool atEnd() {
+      skipSpaces();
+      return mCur == mEnd;
+    }
+
+    /** Consumes a command letter, if any */
+    bool command(char &c) {
+      skipSpaces();
+      if ( mCur == mEnd || !std::strchr("MmLlHhVvCcSsQqTtAaZz", *mCur) )
+        return false;
+      c = *mCur++;
+      return true;
+    }
+
+    /** Reads a number, after spaces and an optional comma */
+    bool number(double &v) {
+      separator();
+      if ( mCur < mEnd && *mCur == '+' )
+        mCur++;
+      const auto [end, err] = std::from_chars(mCur, mEnd, v);
+      // from_chars also takes inf and nan
+      if ( err != std::errc() || !std::isfinite(v) )
+        return false;
+      mCur = end;
+      return true;
+    }
+
+    bool point(Vec &p) {
+      return number(p.x) && number(p.y);
+    }
+
+    /** Reads an arc flag, a single 0 or 1 that needs no separator: "a1 1 0 011 1" is valid */
+    bool flag(bool &f) {
+      separator();
+      if ( mCur == mEnd || (*mCur != '0' && *mCur != '1') )
+        return false;
+      f = *mCur++ == '1';
+      return true;
+    }
+
+  private:
+    void separator() {
+      skipSpaces();
+      if ( mCur < mEnd && *mCur == ',' ) {
+        mCur++;
+        skipSpaces();
+      }
+    }
+
+    const char *mCur, *mEnd;
+};
+
+/** Builds the rings from drawing commands, reusing the buffers of the output rings */
+class Flattener {
+  public:
+    Flattener(std::vector<VectorShape> &rings, float tolerance)
+      : mRings(rings), mTolerance(std::max(double(tolerance), 1e-6)) {}
+
+    void moveTo(const Vec &p) {
+      close();
+      mStart = mCur = p;
+      ring().push_back(Point { float(p.x), float(p.y) });
+      mOpen = true;
+    }
+
+    void lineTo(const Vec &p) {
+      // drawing after a Z starts a new subpath at the start of the closed one
+      if ( !mOpen )
+        moveTo(mStart);
+      mRings[mUsed-1].push_back(Point { float(p.x), float(p.y) });
+      mCur = p;
+    }
+
+    void cubicTo(const Vec &c1, const Vec &c2, const Vec &e) {
+      cubic(mCur, c1, c2, e, 0);
+    }
+
+    void quadTo(const Vec &c, const Vec &e) {
+      // degree elevation, the cubic is the same curve
+      const Vec &s = mCur;
+      cubic(s, Vec { s.x + 2./3. * (c.x - s.x), s.y + 2./3. * (c.y - s.y) },
+               Vec { e.x + 2./3. * (c.x - e.x), e.y + 2./3. * (c.y - e.y) }, e, 0);
+    }
+
+    void arcTo(double rx, double ry, double xAxisRotation, bool largeArc, bool sweep, const Vec &e);
+
+    /** Ends the current subpath */
+    void close() {
+      if ( mOpen ) {
+        VectorShape &r = mRings[mUsed-1];
+        if ( r.size() > 1 && r.back().x == r.front().x && r.back().y == r.front().y )
+          r.pop_back();
+      }
+      mOpen = false;
+      mCur = mStart;
+    }
+
+    /** Closes the last subpath and drops the unused rings */
+    void finish() {
+      close();
+      mRings.resize(mUsed);
+    }
+
+    const Vec &current() const { return mCur; }
+
+  private:
+    VectorShape &ring() {
+      if ( mUsed == mRings.size() )
+        mRings.emplace_back();
+      VectorShape &r = mRings[mUsed++];
+      r.clear();
+      return r;
+    }
+
+    /** Splits the curve in halves until each one is within the tolerance of its chord */
+    void cubic(const Vec &p0, const Vec &p1, const Vec &p2, const Vec &p3, unsigned depth);
+
+    std::vector<VectorShape> &mRings;
+    double mTolerance;
+    std::size_t mUsed = 0;
+    bool mOpen = false;
+    Vec mStart { 0., 0. }, mCur { 0., 0. };
+};
+
+// the arc handling code underneath is from XSVG (BSD license)
+/*
+ * Copyright  2002 USC/Information Sciences Institute
+ *
+ * Permission to use, copy, modify, distribute, and sell this software
+ * and its documentation for any purpose is hereby granted without
+ * fee, provided that the above copyright notice appear in all copies
+ * and that both that copyright notice and this permission notice
+ * appear in supporting documentation, and that the name of
+ * Information Sciences Institute not be used in advertising or
+ * publicity pertaining to distribution of the software without
+ * specific, written prior permission.  Information Sciences Institute
+ * makes no representations about the suitability of this software for
+ * any purpose.  It is provided "as is" without express or implied
+ * warranty.
+ *
+ * INFORMATION SCIENCES INSTITUTE DISCLAIMS ALL WARRANTIES WITH REGARD
+ * TO THIS SOFTWARE, INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS, IN NO EVENT SHALL INFORMATION SCIENCES
+ * INSTITUTE BE LIABLE FOR ANY SPECIAL, INDIRECT OR CONSEQUENTIAL
+ * DAMAGES OR ANY DAMAGES WHATSOEVER RESULTING FROM LOSS OF USE, DATA
+ * OR PROFITS, WHETHER IN AN ACTION OF CONTRACT, NEGLIGENCE OR OTHER
+ * TORTIOUS ACTION, ARISING OUT OF OR IN CONNECTION WITH THE USE OR
+ * PERFORMANCE OF THIS SOFTWARE.
+ *
+ */
+
+void Flattener::cubic(const Vec &p0, const Vec &p1, const Vec &p2, const Vec &p3, unsigned depth)
+{
+  // the curve is in the hull of its control points, and within 3/4 of their largest distance to the chord
+  // if they project onto it. Without chord, e.g. a closed loop, only control points close to the start
+  // make it flat
+  const double dx = p3.x - p0.x, dy = p3.y - p0.y, length2 = dx*dx + dy*dy;
+  const double d1 = (p1.x - p0.x) * dy - (p1.y - p0.y) * dx, d2 = (p2.x - p0.x) * dy - (p2.y - p0.y) * dx;
+  const double t1 = (p1.x - p0.x) * dx + (p1.y - p0.y) * dy, t2 = (p2.x - p0.x) * dx + (p2.y - p0.y) * dy;
+  const double tolerance2 = mTolerance * mTolerance;
+  const auto near = [&](const Vec &p) { return (p.x - p0.x) * (p.x - p0.x) + (p.y - p0.y) * (p.y - p0.y) <= tolerance2; };
+  const bool flat = (length2 > 0. && t1 >= 0. && t1 <= length2 && t2 >= 0. && t2 <= length2 &&
+                     9./16. * std::max(d1*d1, d2*d2) <= tolerance2 * length2) ||
+                    (near(p1) && near(p2) && near(p3));
+  // depth bounds the work on huge coordinates
+  if ( flat || depth == 16 ) {
+    lineTo(p3);
+    return;
+  }
+  const auto mid = [](const Vec &a, const Vec &b) { return Vec { 0.5 * (a.x + b.x), 0.5 * (a.y + b.y) }; };
+  const Vec p01 = mid(p0, p1), p12 = mid(p1, p2), p23 = mid(p2, p3);
+  const Vec p012 = mid(p01, p12), p123 = mid(p12, p23);
+  const Vec m = mid(p012, p123);
+  cubic(p0, p01, p012, m, depth + 1);
+  cubic(m, p123, p23, p3, depth + 1);
+}
+
+void Flattener::arcTo(double rx, double ry, double xAxisRotation, bool largeArc, bool sweep, const Vec &e)
+{
+  // degenerate arcs are straight lines
+  if ( !rx || !ry ) {
+    lineTo(e);
+    return;
+  }
+  constexpr double pi = 3.14159265358979323846;
+  rx = std::abs(rx);
+  ry = std::abs(ry);
+  const double sinRot = std::sin(xAxisRotation * (pi / 180.0));
+  const double cosRot = std::cos(xAxisRotation * (pi / 180.0));
+  const double dx = (mCur.x - e.x) / 2.0;
+  const double dy = (mCur.y - e.y) / 2.0;
+  const double dx1 =  cosRot * dx + sinRot * dy;
+  const double dy1 = -sinRot * dx + cosRot * dy;
+  // spec: radii too small to join both ends are scaled up
+  const double check = dx1 * dx1 / (rx * rx) + dy1 * dy1 / (ry * ry);
+  if ( check > 1 ) {
+    rx *= std::sqrt(check);
+    ry *= std::sqrt(check);
+  }
+  const double a00 =  cosRot / rx;
+  const double a01 =  sinRot / rx;
+  const double a10 = -sinRot / ry;
+  const double a11 =  cosRot / ry;
+  // both ends in the space where the arc is on a unit circle
+  const double x0 = a00 * mCur.x + a01 * mCur.y;
+  const double y0 = a10 * mCur.x + a11 * mCur.y;
+  const double x1 = a00 * e.x + a01 * e.y;
+  const double y1 = a10 * e.x + a11 * e.y;
+  const double d = (x1 - x0) * (x1 - x0) + (y1 - y0) * (y1 - y0);
+  if ( !d )
+    return;
+  double sfactor = std::sqrt(std::max(0., 1.0 / d - 0.25));
+  if ( sweep == largeArc )
+    sfactor = -sfactor;
+  const Vec c { 0.5 * (x0 + x1) - sfactor * (y1 - y0), 0.5 * (y0 + y1) + sfactor * (x1 - x0) };
+  const double th0 = std::atan2(y0 - c.y, x0 - c.x);
+  const double th1 = std::atan2(y1 - c.y, x1 - c.x);
+  double thArc = th1 - th0;
+  if ( thArc < 0 && sweep )
+    thArc += 2 * pi;
+  else if ( thArc > 0 && !sweep )
+    thArc -= 2 * pi;
+  // the sagitta of a step on the largest radius is the tolerance, steps stay under a quarter turn
+  const double step = std::min(pi * 0.5, 2. * std::acos(std::max(0., 1. - mTolerance / std::max(rx, ry))));
+  // as many steps as the subdivision depth of the curves at most
+  const int segments = int(std::min(65536., std::ceil(std::abs(thArc) / step)));
+  for (int i=1; i<segments; i++) {
+    const double th = th0 + i * thArc / segments;
+    const double x = c.x + std::cos(th), y = c.y + std::sin(th);
+    lineTo(Vec { cosRot * rx * x - sinRot * ry * y, sinRot * rx * x + cosRot * ry * y });
+  }
+  // land exactly on the end point
+  lineTo(e);
+}
+
+}
+
+bool svg2path(std::string_view d, std::vector<VectorShape> &rings, float tolerance)
+{
+  PathParser p(d);
+  Flattener out(rings, tolerance);
+
+  char cmd = 0, last = 0;
+  // last control point of a C/S or Q/T command, reflected by the next S or T
+  Vec ctrl { 0., 0. };
+  bool ok = true;
+  while ( ok && !p.atEnd() ) {
+    // without a new command letter, the previous command is repeated
+    if ( !p.command(cmd) && (!cmd || cmd == 'Z' || cmd == 'z') ) {
+      ok = false;
+      break;
+    }
+
+    const Vec cur = out.current();
+    const bool rel = std::islower(static_cast<unsigned char>(cmd));
+    const double ox = rel ? cur.x : 0., oy = rel ? cur.y : 0.;
+    const char op = std::toupper(static_cast<unsigned char>(cmd));
+    Vec a, b, e;
+    switch ( op ) {
+      case 'M':
+        if ( (ok = p.point(e)) ) {
+          out.moveTo(Vec { e.x + ox, e.y + oy });
+          // following pairs are implicit line tos
+          cmd = rel ? 'l' : 'L';
+        }
+        break;
+      case 'L':
+        if ( (ok = p.point(e)) )
+          out.lineTo(Vec { e.x + ox, e.y + oy });
+        break;
+      case 'H':
+        if ( (ok = p.number(e.x)) )
+          out.lineTo(Vec { e.x + ox, cur.y });
+        break;
+      case 'V':
+        if ( (ok = p.number(e.y)) )
+          out.lineTo(Vec { cur.x, e.y + oy });
+        break;
+      case 'C':
+        if ( (ok = p.point(a) && p.point(b) && p.point(e)) ) {
+          ctrl = Vec { b.x + ox, b.y + oy };
+          out.cubicTo(Vec { a.x + ox, a.y + oy }, ctrl, Vec { e.x + ox, e.y + oy });
+        }
+        break;
+      case 'S':
+        if ( (ok = p.point(b) && p.point(e)) ) {
+          a = last == 'C' || last == 'S' ? Vec { 2*cur.x - ctrl.x, 2*cur.y - ctrl.y } : cur;
+          ctrl = Vec { b.x + ox, b.y + oy };
+          out.cubicTo(a, ctrl, Vec { e.x + ox, e.y + oy });
+        }
+        break;
+      case 'Q':
+        if ( (ok = p.point(a) && p.point(e)) ) {
+          ctrl = Vec { a.x + ox, a.y + oy };
+          out.quadTo(ctrl, Vec { e.x + ox, e.y + oy });
+        }
+        break;
+      case 'T':
+        if ( (ok = p.point(e)) ) {
+          ctrl = last == 'Q' || last == 'T' ? Vec { 2*cur.x - ctrl.x, 2*cur.y - ctrl.y } : cur;
+          out.quadTo(ctrl, Vec { e.x + ox, e.y + oy });
+        }
+        break;
+      case 'A': {
+        double rx, ry, rotation;
+        bool largeArc, sweep;
+        if ( (ok = p.number(rx) && p.number(ry) && p.number(rotation) && p.flag(largeArc) && p.flag(sweep) && p.point(e)) )
+          out.arcTo(rx, ry, rotation, largeArc, sweep, Vec { e.x + ox, e.y + oy });
+        break;
+      }
+      case 'Z':
+        out.close();
+        break;
+    }
+    last = op;
+  }
+
+  out.finish();
+  return ok;
+}
+
+};
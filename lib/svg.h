@@ -0,0 +1,32 @@
+#pragma once
+
+#ifdef FLUBBERPP_LIBRARY
+#if _WIN32
+#define FLUBBERPP_EXPORT __declspec(dllexport)
+#else
+#define FLUBBERPP_EXPORT __attribute__((visibility("default")))
+#endif
+#else
+#define FLUBBERPP_EXPORT
+#endif
+
+#include "shape.h"
+
+#include <string_view>
+#include <vector>
+
+namespace flubberpp {
+
+/** Parses the 'd' attribute of an SVG path and flattens it into one ring per subpath, in a
+ *  single pass. All the commands are supported, absolute and relative: M L H V C S Q T A Z.
+ *  Curves and arcs are subdivided adaptively, with as few segments as keep the curve within
+ *  @c tolerance of them: flat parts cost no points.
+ *  normalize() splits the rings further into segments of at most maxSegmentLength, so a
+ *  tolerance around a tenth of the maxSegmentLength of the interpolation is enough.
+ *  Rings are implicitly closed: a last point equal to the first one is dropped.
+ *  The rings replace the contents of @c rings, whose buffers are reused.
+ *  Returns false if the path is not valid, leaving @c rings with the rings parsed so far
+ */
+FLUBBERPP_EXPORT bool svg2path(std::string_view d, std::vector<VectorShape> &rings, float tolerance = 0.25f);
+
+};
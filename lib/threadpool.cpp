@@ -0,0 +1,100 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace flubberpp {
+
+ThreadPool::ThreadPool(unsigned threads)
+  : mTask(nullptr)
+  , mGeneration(0)
+  , mBusy(0)
+  , mStop(false)
+{
+  threads = std::max(1u, threads);
+  for (unsigned i=0; i<threads; i++)
+    mQueues.push_back(std::make_unique<Queue>());
+  for (unsigned i=0; i+1<threads; i++)
+    mWorkers.emplace_back(&ThreadPool::work, this, i+1);
+}
+
+ThreadPool::~ThreadPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mStop = true;
+  }
+  mWake.notify_all();
+  for (auto &w: mWorkers)
+    w.join();
+}
+
+void ThreadPool::run(std::size_t count, const std::function<void(std::size_t)> &task)
+{
+  if ( !count )
+    return;
+
+  for (std::size_t i=0; i<count; i++) {
+    Queue &q = *mQueues[i % mQueues.size()];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    q.tasks.push_back(i);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mMutex);
+    mTask = &task;
+    mBusy = mWorkers.size();
+    mGeneration++;
+  }
+  mWake.notify_all();
+
+  std::size_t i;
+  while ( next(0, i) )
+    task(i);
+
+  std::unique_lock<std::mutex> lock(mMutex);
+  mDone.wait(lock, [this]() { return mBusy == 0; });
+  mTask = nullptr;
+}
+
+void ThreadPool::work(unsigned self)
+{
+  unsigned generation = 0;
+  for (;;) {
+    const std::function<void(std::size_t)> *task;
+    {
+      std::unique_lock<std::mutex> lock(mMutex);
+      mWake.wait(lock, [this,generation]() { return mStop || mGeneration != generation; });
+      if ( mStop )
+        return;
+      generation = mGeneration;
+      task = mTask;
+    }
+
+    std::size_t i;
+    while ( next(self, i) )
+      (*task)(i);
+
+    {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mBusy--;
+    }
+    mDone.notify_one();
+  }
+}
+
+bool ThreadPool::next(unsigned self, std::size_t &task)
+{
+  // own tasks first, then steal from the others
+  for (unsigned k=0; k<mQueues.size(); k++) {
+    Queue &q = *mQueues[(self+k) % mQueues.size()];
+    std::lock_guard<std::mutex> lock(q.mutex);
+    if ( !q.tasks.empty() ) {
+      task = q.tasks.front();
+      q.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+}
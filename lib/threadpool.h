@@ -0,0 +1,65 @@
+#pragma once
+
+#ifdef FLUBBERPP_LIBRARY
+#if _WIN32
+#define FLUBBERPP_EXPORT __declspec(dllexport)
+#else
+#define FLUBBERPP_EXPORT __attribute__((visibility("default")))
+#endif
+#else
+#define FLUBBERPP_EXPORT
+#endif
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace flubberpp {
+
+/** A pool of worker threads running parallel loops with work stealing */
+class FLUBBERPP_EXPORT ThreadPool {
+  public:
+    /** Starts threads-1 workers, the thread calling run() being the last one */
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    /** Number of threads taking part in run() */
+    unsigned size() const { return mQueues.size(); }
+
+    /** Calls task(i) for i in [0,count[ and returns once they are all done.
+     *  Tasks are dealt in this order to the threads, each thread taking its own tasks in order
+     *  then stealing the next task of the others, so that putting the longest tasks first
+     *  balances the load. Not reentrant
+     */
+    void run(std::size_t count, const std::function<void(std::size_t)> &task);
+
+  private:
+    struct Queue {
+      std::mutex mutex;
+      std::deque<std::size_t> tasks;
+    };
+
+    void work(unsigned self);
+    bool next(unsigned self, std::size_t &task);
+
+    std::vector<std::unique_ptr<Queue>> mQueues;
+    std::vector<std::thread> mWorkers;
+
+    std::mutex mMutex;
+    std::condition_variable mWake, mDone;
+    const std::function<void(std::size_t)> *mTask;
+    // incremented by each run(), workers wait for a new one
+    unsigned mGeneration;
+    unsigned mBusy;
+    bool mStop;
+};
+
+}
@@ -0,0 +1,69 @@
+#include "flubberpp.h"
+#include "rotation.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace flubberpp {
+
+MorphTimeline::MorphTimeline(const std::vector<VectorShape> &keyframes, float maxSegmentLength, RotationMethod method)
+{
+  std::vector<VectorShape> rings(keyframes);
+  for (auto &r: rings)
+    r.normalize(maxSegmentLength);
+  // a single keyframe stands still
+  if ( rings.size() == 1 )
+    rings.push_back(rings.front());
+
+  size_t n = 0;
+  for (size_t i=0; i+1<rings.size(); i++) {
+    // same steps as SingleInterpolator::setup(), on copies of the normalized keyframes
+    VectorShape from = rings[i], to = rings[i+1];
+    if ( from.size() > to.size() ) {
+      to.addPoints(from.size() - to.size());
+    } else {
+      from.addPoints(to.size() - from.size());
+    }
+
+    const unsigned offset = rotation::find(method, from.data(), to.data(), from.size());
+    if ( offset ) {
+      std::rotate(from.begin(),std::next(from.begin(),offset),from.end());
+    }
+
+    mMorphs.push_back(std::make_shared<const PreparedMorph>(from.cbegin(), from.cend(), to.cbegin()));
+    n = std::max(n, from.size());
+  }
+
+  mCurX.resize(n);
+  mCurY.resize(n);
+  mCur.reserve(n);
+}
+
+const VectorShape &MorphTimeline::at(float t)
+{
+  const XYSpan xy = atXY(t);
+
+  mCur.resize(xy.size);
+  for (size_t i=0; i<xy.size; i++) {
+    mCur[i] = Point { xy.x[i], xy.y[i] };
+  }
+
+  return mCur;
+}
+
+XYSpan MorphTimeline::atXY(float t)
+{
+  if ( mMorphs.empty() )
+    return XYSpan { mCurX.data(), mCurY.data(), 0 };
+
+  // transition of global time t, and time within it
+  const float pos = t * mMorphs.size();
+  const size_t i = pos <= 0.f ? 0 : std::min(size_t(pos), mMorphs.size() - 1);
+  const PreparedMorph &morph = *mMorphs[i];
+
+  morph.at(pos - i, mCurX.data(), mCurY.data());
+
+  return XYSpan { mCurX.data(), mCurY.data(), morph.size() };
+}
+
+}
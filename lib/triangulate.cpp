@@ -0,0 +1,214 @@
+#include "triangulate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <numeric>
+#include <set>
+#include <unordered_map>
+
+#include "earcut.hpp"
+
+// Make earcut library able to use our Point type
+namespace mapbox {
+namespace util {
+
+template <>
+struct nth<0, flubberpp::Point> {
+    inline static auto get(const flubberpp::Point &t) {
+        return t.x;
+    };
+};
+template <>
+struct nth<1, flubberpp::Point> {
+    inline static auto get(const flubberpp::Point &t) {
+        return t.y;
+    };
+};
+
+} // namespace util
+} // namespace mapbox
+
+namespace flubberpp {
+
+namespace {
+
+std::vector<uint32_t> earcut(const VectorShape &s)
+{
+  // earcut expects a polygon = main shape + hole1 + hole2 + ...
+  // we assume we don't have holes
+  std::vector<VectorShape> polygon;
+  polygon.push_back(s);
+  return mapbox::earcut(polygon);
+}
+
+uint64_t edgeKey(uint32_t a, uint32_t b)
+{
+  return uint64_t(a) << 32 | b;
+}
+
+/** A set of adjacent triangles being merged */
+struct Piece {
+  float area;
+  std::vector<uint32_t> triangles;
+  // adjacent pieces, may be merged ones (resolved through the union-find). Without
+  // duplicates once the piece merged: one entry per neighbour, not per shared edge
+  std::vector<uint32_t> neighbours;
+};
+
+/** Union-find over pieces, with path halving */
+uint32_t find(std::vector<uint32_t> &parent, uint32_t i)
+{
+  while ( parent[i] != i ) {
+    parent[i] = parent[parent[i]];
+    i = parent[i];
+  }
+  return i;
+}
+
+/** Chains the directed boundary edges of a piece into a ring. A piece may touch itself at a
+ *  vertex, hence an Euler circuit (Hierholzer) rather than a simple walk
+ */
+std::vector<uint32_t> chain(const std::vector<std::pair<uint32_t,uint32_t>> &edges)
+{
+  std::unordered_map<uint32_t, std::vector<uint32_t>> out;
+  out.reserve(edges.size());
+  for (const auto &e: edges)
+    out[e.first].push_back(e.second);
+
+  std::vector<uint32_t> stack { edges.front().first }, ring;
+  ring.reserve(edges.size()+1);
+  while ( !stack.empty() ) {
+    auto &next = out[stack.back()];
+    if ( next.empty() ) {
+      ring.push_back(stack.back());
+      stack.pop_back();
+    } else {
+      stack.push_back(next.back());
+      next.pop_back();
+    }
+  }
+
+  // the circuit comes out reversed and closed
+  ring.pop_back();
+  std::reverse(ring.begin(), ring.end());
+  return ring;
+}
+
+}
+
+VectorShapeSet triangulate(const VectorShape &s)
+{
+  VectorShapeSet res(lessArea<VectorShape>);
+
+  const auto indices = earcut(s);
+  for (size_t i=0; i+2<indices.size(); i+=3) {
+    // Note: we have no holes so all indices lie within s
+    res.insert({ s[indices[i]], s[indices[i+1]], s[indices[i+2]] }); // sorted insert
+  }
+
+  return res;
+}
+
+std::vector<VectorShape> cut(const VectorShape &s, unsigned pieces)
+{
+  std::vector<VectorShape> res;
+
+  auto tri = earcut(s);
+  const uint32_t count = tri.size() / 3;
+  if ( !count || !pieces )
+    return res;
+
+  // orient the triangles like the shape, so that internal edges appear in both directions.
+  // The vertices of a triangle of a simple polygon come in the polygon order, which also
+  // holds for flat triangles whose area says nothing
+  std::vector<Piece> p(count);
+  for (uint32_t t=0; t<count; t++) {
+    std::sort(tri.begin()+3*t, tri.begin()+3*t+3);
+    const VectorShape triangle { s[tri[3*t]], s[tri[3*t+1]], s[tri[3*t+2]] };
+    p[t].area = std::abs(triangle.area());
+    p[t].triangles.push_back(t);
+  }
+
+  // adjacency through shared edges: the triangle across edge a->b owns edge b->a
+  std::unordered_map<uint64_t, uint32_t> edges;
+  edges.reserve(3*count);
+  for (uint32_t t=0; t<3*count; t++)
+    edges.emplace(edgeKey(tri[t], tri[t%3 == 2 ? t-2 : t+1]), t/3);
+
+  auto across = [&edges,count](uint32_t a, uint32_t b) {
+    const auto other = edges.find(edgeKey(b, a));
+    return other != edges.end() ? other->second : count;
+  };
+
+  for (uint32_t t=0; t<count; t++) {
+    for (int k=0; k<3; k++) {
+      const uint32_t n = across(tri[3*t+k], tri[3*t+(k+1)%3]);
+      if ( n != count )
+        p[t].neighbours.push_back(n);
+    }
+  }
+
+  // merge the smallest piece with its smallest neighbour until there are few enough pieces
+  std::vector<uint32_t> parent(count);
+  std::iota(parent.begin(), parent.end(), 0);
+  std::set<std::pair<float,uint32_t>> byArea;
+  for (uint32_t t=0; t<count; t++)
+    byArea.emplace(p[t].area, t);
+
+  while ( byArea.size() > pieces ) {
+    const uint32_t smallest = byArea.begin()->second;
+
+    uint32_t best = smallest;
+    for (auto &n: p[smallest].neighbours) {
+      n = find(parent, n);
+      if ( n != smallest && (best == smallest || p[n].area < p[best].area || (p[n].area == p[best].area && n < best)) )
+        best = n;
+    }
+    if ( best == smallest ) // isolated piece: cannot merge any more
+      break;
+
+    byArea.erase(byArea.begin());
+    byArea.erase({p[best].area, best});
+
+    // merge the smaller lists into the bigger ones
+    uint32_t into = best, from = smallest;
+    if ( p[into].triangles.size() < p[from].triangles.size() )
+      std::swap(into, from);
+    parent[from] = into;
+    p[into].area += p[from].area;
+    p[into].triangles.insert(p[into].triangles.end(), p[from].triangles.begin(), p[from].triangles.end());
+    auto &neighbours = p[into].neighbours;
+    neighbours.insert(neighbours.end(), p[from].neighbours.begin(), p[from].neighbours.end());
+    for (auto &n: neighbours)
+      n = find(parent, n);
+    neighbours.erase(std::remove(neighbours.begin(), neighbours.end(), into), neighbours.end());
+    std::sort(neighbours.begin(), neighbours.end());
+    neighbours.erase(std::unique(neighbours.begin(), neighbours.end()), neighbours.end());
+    p[from] = Piece();
+    byArea.emplace(p[into].area, into);
+  }
+
+  // boundary of each piece: triangle edges whose reverse is not in the same piece
+  for (const auto &entry: byArea) {
+    const uint32_t piece = entry.second;
+    std::vector<std::pair<uint32_t,uint32_t>> boundary;
+    for (const auto t: p[piece].triangles) {
+      for (int k=0; k<3; k++) {
+        const uint32_t a = tri[3*t+k], b = tri[3*t+(k+1)%3];
+        const uint32_t neighbour = across(a, b);
+        if ( neighbour == count || find(parent, neighbour) != piece )
+          boundary.emplace_back(a, b);
+      }
+    }
+
+    VectorShape ring;
+    for (const auto i: chain(boundary))
+      ring.push_back(s[i]);
+    res.push_back(std::move(ring));
+  }
+
+  return res;
+}
+
+}
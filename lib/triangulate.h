@@ -0,0 +1,23 @@
+#pragma once
+
+#include "shape.h"
+
+#include <vector>
+
+namespace flubberpp {
+
+/** Cuts the shape into triangles using the earcut method. Returns a sorted set
+ *  wrt to areas */
+VectorShapeSet triangulate(const VectorShape &s);
+
+/** Cuts the shape into @c pieces pieces of balanced areas: the shape is triangulated with
+ *  earcut, then the smallest piece is repeatedly merged with its smallest neighbour until
+ *  @c pieces pieces remain. Each piece is returned as a ring with the orientation of @c s.
+ *  A merge costs O(d log d) for the d distinct neighbours of both pieces, so merging is
+ *  O(N log N) overall when pieces have few neighbours, as along thin strips. earcut itself
+ *  can be quadratic, e.g. on long thin strips. Fewer pieces are returned if the shape has
+ *  fewer triangles
+ */
+std::vector<VectorShape> cut(const VectorShape &s, unsigned pieces);
+
+}
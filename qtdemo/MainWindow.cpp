@@ -1,18 +1,16 @@
 #include "MainWindow.h"
 #include "./ui_MainWindow.h"
 #include "flubberpp.h"
-//#include "svg_d2qpainterpath.h"
+#include "loader.h"
 
 #include <QPainterPath>
 #include <QGraphicsScene>
 #include <QDebug>
 #include <QTimer>
-#include <QJsonDocument>
-#include <QJsonArray>
 #include <QFile>
 
-// will contain result of svg string conversion to Qt shape
-static QVector<QPolygonF> shapes;
+// shapes of the current dataset
+static flubberpp::PackedShapes shapes;
 
 MainWindow::MainWindow(QWidget *parent)
   : QMainWindow(parent)
@@ -117,19 +115,11 @@ void MainWindow::slot_interpolationFinished()
 
 void MainWindow::slot_triggerNextInterpolation()
 {
-  QPolygonF start_shape = shapes[path_idx%shapes.size()];
-  QPolygonF end_shape = shapes[(path_idx+1)%shapes.size()];
+  const size_t start_idx = path_idx%shapes.size();
+  const size_t end_idx = (path_idx+1)%shapes.size();
 
-  // Now convert shapes to flubberpp shapes
-  flubberpp::VectorShape from;
-  for (auto p: start_shape) {
-    from.push_back({(float)p.x(),(float)p.y()});
-  }
-
-  flubberpp::VectorShape to;
-  for (auto p: end_shape) {
-    to.push_back({(float)p.x(),(float)p.y()});
-  }
+  flubberpp::VectorShape from(shapes.begin(start_idx), shapes.end(start_idx));
+  flubberpp::VectorShape to(shapes.begin(end_idx), shapes.end(end_idx));
 
   interp.setStartShape(from);
   interp.setEndShape(to);
@@ -213,40 +203,12 @@ void MainWindow::slot_datasetChanged(int idx)
   if ( !f.open(QIODevice::ReadOnly) )
     return;
 
-  QJsonParseError err;
-  QJsonDocument doc = QJsonDocument::fromJson(f.readAll(), &err);
-  if ( err.error != QJsonParseError::NoError )
+  // keep the current shapes if the file is not valid
+  const QByteArray data = f.readAll();
+  flubberpp::PackedShapes loaded;
+  if ( !flubberpp::parseShapes(std::string_view(data.constData(), data.size()), loaded) || !loaded.size() )
     return;
-
-  if ( !doc.isArray() )
-    return;
-
-  QJsonArray jall = doc.array();
-
-  shapes.clear();
-
-  for (auto js: jall) {
-    if ( !js.isArray() )
-      continue;
-
-    QJsonArray jpoly = js.toArray();
-    QPolygonF poly;
-    for (auto jpoint: jpoly) {
-      if ( !jpoint.isArray() )
-           continue;
-      QJsonArray pt = jpoint.toArray();
-      if ( pt.size() != 2 )
-        continue;
-      if ( !pt.at(0).isDouble() )
-        continue;
-      if ( !pt.at(1).isDouble() )
-        continue;
-
-      poly << QPointF(pt.at(0).toDouble(),pt.at(1).toDouble());
-    }
-
-    shapes << poly;
-  }
+  shapes = std::move(loaded);
 
   if ( timeAnim.state() == QAbstractAnimation::Running )
     timeAnim.pause();
@@ -1,5 +0,0 @@
-#pragma once
-
-#include <QPainterPath>
-
-bool svg2path(const QString &dataStr, QPainterPath &path);